@@ -0,0 +1,136 @@
+/**
+ * @file
+ * @brief Compile time baud rate calculation for the USART.
+ *
+ * Derives the UBRR value and the double speed (U2X) setting from the
+ * requested baud rate ::UART_BAUD and \b F_CPU. Both are plain constants, no
+ * code is generated for the calculation. If the baud rate can not be reached
+ * within ::UART_BAUD_TOL, the build fails.
+ *
+ * Example:
+ * \code
+ * #define F_CPU 10000000UL
+ * #define UART_BAUD 250000UL
+ * #include "baud.h"
+ *
+ * USART_Init( UART_UBRR , UART_USE_2X );
+ * \endcode
+ *
+ * @pre \b F_CPU must be defined before this file is included.
+ *
+ * @see USART_Init
+ */
+
+#ifndef BAUD_H_INCLUDED
+#define BAUD_H_INCLUDED
+
+#ifndef F_CPU
+#error "F_CPU must be defined before baud.h is included"
+#endif
+
+#ifndef UART_BAUD
+/**
+ * @brief Requested baud rate in bits per second.
+ *
+ * This value can be overridden by defining it before baud.h is included. The
+ * default gives the same setting as the former magic value 0x40 with U2X at
+ * 10 MHz.
+ */
+#define UART_BAUD 19200UL
+#endif
+
+#ifndef UART_BAUD_TOL
+/**
+ * @brief Largest accepted baud rate error in per mille.
+ *
+ * The Atmega32 data sheet recommends at most 1.5 % receiver error for 8 data
+ * bits in double speed mode, so this is the default. Can be overridden by
+ * defining it before baud.h is included.
+ */
+#define UART_BAUD_TOL 15
+#endif
+
+/**
+ * @brief Biggest value the 12 bit UBRR register can hold.
+ */
+#define UART_UBRR_MAX 4095
+
+/**
+ * @brief Rounded UBRR value for a baud rate.
+ *
+ * @param BAUD baud rate in bits per second.
+ * @param DIV 16 for normal speed, 8 for double speed (U2X).
+ */
+#define UART_UBRR_FOR( BAUD , DIV ) \
+	( ( (F_CPU) + (DIV) * (BAUD) / 2 ) / ( (DIV) * (BAUD) ) - 1 )
+
+/**
+ * @brief Tells if ::UART_UBRR_FOR gives a value that fits into UBRR.
+ *
+ * Too high baud rates make the rounded divisor 0, the value then wraps
+ * around and is caught here as well.
+ */
+#define UART_UBRR_VALID( BAUD , DIV ) ( UART_UBRR_FOR( BAUD , DIV ) <= UART_UBRR_MAX )
+
+/**
+ * @brief Baud rate that is actually reached with ::UART_UBRR_FOR.
+ */
+#define UART_ACTUAL_BAUD( BAUD , DIV ) \
+	( (F_CPU) / ( (DIV) * ( UART_UBRR_FOR( BAUD , DIV ) + 1 ) ) )
+
+/**
+ * @brief Baud rate error in per mille, rounded down.
+ *
+ * Invalid UBRR values give an error of 1000 (100 %).
+ */
+#define UART_ERROR_FOR( BAUD , DIV ) \
+	( !UART_UBRR_VALID( BAUD , DIV ) ? 1000 : \
+	  UART_ACTUAL_BAUD( BAUD , DIV ) > (BAUD) \
+	  ? ( UART_ACTUAL_BAUD( BAUD , DIV ) - (BAUD) ) * 1000 / (BAUD) \
+	  : ( (BAUD) - UART_ACTUAL_BAUD( BAUD , DIV ) ) * 1000 / (BAUD) )
+
+/**
+ * @brief 1 if double speed should be used for a baud rate, 0 otherwise.
+ *
+ * Double speed is only chosen if it gives a smaller error, because it halves
+ * the number of samples the receiver takes per bit.
+ */
+#define UART_USE_2X_FOR( BAUD ) ( UART_ERROR_FOR( BAUD , 8 ) < UART_ERROR_FOR( BAUD , 16 ) )
+
+/**
+ * @brief UBRR value for a baud rate, matching ::UART_USE_2X_FOR.
+ */
+#define UART_UBRR_FOR_BAUD( BAUD ) \
+	( UART_USE_2X_FOR( BAUD ) ? UART_UBRR_FOR( BAUD , 8 ) : UART_UBRR_FOR( BAUD , 16 ) )
+
+/**
+ * @brief Baud rate error in per mille, matching ::UART_USE_2X_FOR.
+ */
+#define UART_ERROR_FOR_BAUD( BAUD ) \
+	( UART_USE_2X_FOR( BAUD ) ? UART_ERROR_FOR( BAUD , 8 ) : UART_ERROR_FOR( BAUD , 16 ) )
+
+/**
+ * @brief 1 if a baud rate can be reached within ::UART_BAUD_TOL.
+ */
+#define UART_BAUD_OK( BAUD ) ( UART_ERROR_FOR_BAUD( BAUD ) <= UART_BAUD_TOL )
+
+/**
+ * @brief UBRR value for ::UART_BAUD.
+ */
+#define UART_UBRR UART_UBRR_FOR_BAUD( UART_BAUD )
+
+/**
+ * @brief Double speed setting for ::UART_BAUD.
+ */
+#define UART_USE_2X UART_USE_2X_FOR( UART_BAUD )
+
+/**
+ * @brief Baud rate error for ::UART_BAUD in per mille.
+ */
+#define UART_BAUD_ERROR UART_ERROR_FOR_BAUD( UART_BAUD )
+
+#if !UART_BAUD_OK( UART_BAUD )
+#error "UART_BAUD can not be reached with F_CPU within UART_BAUD_TOL"
+#endif
+
+#endif /* BAUD_H_INCLUDED */
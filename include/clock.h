@@ -0,0 +1,168 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include <util/atomic.h>
+
+/** @file
+ * @brief Running 32 bit time base for time stamps and latency measurements.
+ *
+ * Timer 1 runs free in normal mode once lcd_async_init() was called. This
+ * file counts its overflows in software, which makes a 32 bit clock out of
+ * its 16 bits. Nothing is taken away from lcd_async.h or lcd_marquee.h, which
+ * only use the compare units.
+ *
+ * One tick is ::CLOCK_CLOCKDIVISION CPU cycles, 0.8 us with the LCD timing
+ * at 10 MHz. The clock goes around after 2^32 ticks, about 57 minutes at
+ * 0.8 us. Differences of up to that are right across the wrap with
+ * clock_elapsed().
+ *
+ * Example:
+ * \code
+ * uint32_t start = clock_now();
+ * spi_async_submit( &txn );
+ * while ( txn.status != SPI_TXN_DONE );
+ * uint32_t us = clock_elapsed_us( start );
+ * \endcode
+ *
+ * @pre timers.h must be included before this file.
+ *
+ * @warning The clock only counts while timer 1 runs in normal mode. The
+ *          blocking macros of display.h put timer 1 into CTC mode and stop
+ *          it, they must not be used after clock_init().
+ */
+
+#ifndef CLOCK_H_INCLUDED
+#define CLOCK_H_INCLUDED
+
+#ifndef CLOCK_CLOCKDIVISION
+# ifdef LCD_CLOCKDIVISION
+/**
+ * @brief Clock division of timer 1.
+ *
+ * The same as ::LCD_CLOCKDIVISION if display.h is included, since both run
+ * on the same timer. 8 otherwise.
+ */
+#  define CLOCK_CLOCKDIVISION LCD_CLOCKDIVISION
+# else
+#  define CLOCK_CLOCKDIVISION 8
+# endif
+#endif
+
+/**
+ * @brief Converts clock ticks to microseconds.
+ *
+ * Calculated with 64 bits, meant for reports rather than for the hot path.
+ *
+ * @param TICKS number of ticks.
+ */
+#define CLOCK_TICKS_US( TICKS ) \
+	( (uint32_t)( (uint64_t)( TICKS ) * CLOCK_CLOCKDIVISION / ( F_CPU / 1000000UL ) ) )
+
+/**
+ * @brief Converts microseconds to clock ticks, for constants.
+ *
+ * @param US time in microseconds.
+ */
+#define CLOCK_US_TICKS( US ) \
+	( (uint32_t)( (uint64_t)( US ) * ( F_CPU / 1000000UL ) / CLOCK_CLOCKDIVISION ) )
+
+/**
+ * @brief Upper 16 bits of the clock, counted by the overflow interrupt.
+ */
+static volatile uint16_t clock_high = 0;
+
+/**
+ * @brief Starts the clock.
+ *
+ * Timer 1 is put into normal mode and started if it is not running yet. Its
+ * count is not reset, so the compare units of lcd_async.h keep their timing.
+ *
+ * @pre Must be called after lcd_async_init() or lcd_async_power_on(), which
+ *      reset timer 1.
+ */
+void clock_init(void)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		clock_high = 0;
+		T1_NORMAL;
+		T1_START_DIV( CLOCK_CLOCKDIVISION );
+		TIFR = _BV( TOV1 );
+		TIMSK |= _BV( TOIE1 );
+	}
+}
+
+/**
+ * @brief Reads the clock.
+ *
+ * Can be called from main and from interrupts. If the timer overflowed but
+ * the interrupt has not counted it yet, the overflow is added here, so the
+ * clock never goes back.
+ *
+ * @return ticks since clock_init().
+ */
+uint32_t clock_now(void)
+{
+	uint16_t high;
+	uint16_t low;
+
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		high = clock_high;
+		low = TCNT1;
+		/* An overflow that is not counted yet. If the count is high, it
+		 * was read before the overflow. */
+		if ( ( TIFR & _BV( TOV1 ) ) && low < 0x8000 )
+		{
+			high++;
+		}
+	}
+	return ( (uint32_t)high << 16 ) | low;
+}
+
+/**
+ * @brief Ticks since an earlier reading of the clock.
+ *
+ * @param start value returned by clock_now().
+ *
+ * @return ticks since \b start, right across the wrap of the clock.
+ */
+uint32_t clock_elapsed(uint32_t start)
+{
+	return clock_now() - start;
+}
+
+/**
+ * @brief Microseconds since an earlier reading of the clock.
+ *
+ * @param start value returned by clock_now().
+ *
+ * @return microseconds since \b start.
+ */
+uint32_t clock_elapsed_us(uint32_t start)
+{
+	return CLOCK_TICKS_US( clock_elapsed( start ) );
+}
+
+/**
+ * @brief Tells if a time span has passed.
+ *
+ * @param start value returned by clock_now().
+ * @param ticks length of the time span, less than 2^31.
+ *
+ * @return 1 if at least \b ticks passed since \b start, 0 otherwise.
+ */
+uint8_t clock_passed(uint32_t start, uint32_t ticks)
+{
+	return clock_elapsed( start ) >= ticks;
+}
+
+/**
+ * @brief interrupt service routine for the upper 16 bits of the clock
+ */
+ISR(TIMER1_OVF_vect)
+{
+	clock_high++;
+}
+
+#endif /* CLOCK_H_INCLUDED */
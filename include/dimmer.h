@@ -0,0 +1,249 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdint.h>
+#include <util/atomic.h>
+
+/** @file
+ * @brief Dims a light from a room configuration item with hardware PWM.
+ *
+ * The HACS server sets numbered configuration items for the room, some of
+ * them are dimmers for lights. This file drives one dimmer on OC2 (PD7)
+ * with timer 2 in phase correct PWM mode, about 2.4 kHz at 10 MHz.
+ *
+ * A brightness level from 0 to 255 is turned into the duty through
+ * ::dimmer_gamma, so equal steps of the level look like equal steps of
+ * brightness. Changes fade: the overflow interrupt of timer 2 moves the
+ * level one step every ::DIMMER_FADE_RATE periods and switches itself off
+ * when the level is reached. The pin is driven by the timer, so a steady
+ * light costs no CPU time at all, and a fade costs one short interrupt per
+ * step.
+ *
+ * Example:
+ * \code
+ * dimmer_init();
+ * sei();
+ * dimmer_set( 255 , DIMMER_FADE_RATE );
+ * ...
+ * dimmer_config( room_config[ DIMMER_CONFIG_ITEM ] );
+ * \endcode
+ *
+ * Timer 2 can be shared with soft_timer.h. The soft timers then tick from
+ * ::dimmer_tick once per PWM period, and the overflow interrupt stays on
+ * while they are used.
+ *
+ * @pre \b F_CPU must be defined and timers.h included before this file.
+ *
+ * @warning Timer 2 is taken. soft_timer.h must be included after this file
+ *          to share it.
+ */
+
+#ifndef DIMMER_H_INCLUDED
+#define DIMMER_H_INCLUDED
+
+#ifdef SOFT_TIMER_H_INCLUDED
+#error "include dimmer.h before soft_timer.h, so the soft timers can tick from the dimmer"
+#endif
+
+#ifndef DIMMER_CONFIG_ITEM
+/**
+ * @brief Room configuration item that sets the dimmer.
+ *
+ * Can be overridden by defining it before this file is included.
+ */
+#define DIMMER_CONFIG_ITEM 0
+#endif
+
+#ifndef DIMMER_CLOCKDIVISION
+/**
+ * @brief Clock division of timer 2, see ::T2_START_DIV.
+ *
+ * The PWM frequency is F_CPU / DIMMER_CLOCKDIVISION / 510.
+ */
+#define DIMMER_CLOCKDIVISION 8
+#endif
+
+#ifndef DIMMER_FADE_MS
+/**
+ * @brief Time of a fade from off to full brightness in milliseconds.
+ *
+ * Can be overridden by defining it before this file is included.
+ */
+#define DIMMER_FADE_MS 500
+#endif
+
+/**
+ * @brief PWM periods per level step for a fade of ::DIMMER_FADE_MS, rounded.
+ */
+#define DIMMER_FADE_RATE ( (uint8_t)( ( (uint32_t)( F_CPU / 1000 ) * DIMMER_FADE_MS \
+	+ (uint32_t)DIMMER_CLOCKDIVISION * 510 * 255 / 2 ) \
+	/ ( (uint32_t)DIMMER_CLOCKDIVISION * 510 * 255 ) ) )
+
+#if ( F_CPU / 1000 * DIMMER_FADE_MS + DIMMER_CLOCKDIVISION * 510UL * 255 / 2 ) \
+	/ ( DIMMER_CLOCKDIVISION * 510UL * 255 ) > 255
+#error "DIMMER_FADE_MS is too long for DIMMER_CLOCKDIVISION"
+#endif
+
+/**
+ * @brief Duty of OC2 for each brightness level, gamma 2.2, in flash.
+ */
+const uint8_t dimmer_gamma[ 256 ] PROGMEM = {
+	  0 ,   0 ,   0 ,   0 ,   0 ,   0 ,   0 ,   0 ,   0 ,   0 ,   0 ,   0 ,   0 ,   0 ,   0 ,   1 ,
+	  1 ,   1 ,   1 ,   1 ,   1 ,   1 ,   1 ,   1 ,   1 ,   2 ,   2 ,   2 ,   2 ,   2 ,   2 ,   2 ,
+	  3 ,   3 ,   3 ,   3 ,   3 ,   4 ,   4 ,   4 ,   4 ,   5 ,   5 ,   5 ,   5 ,   6 ,   6 ,   6 ,
+	  6 ,   7 ,   7 ,   7 ,   8 ,   8 ,   8 ,   9 ,   9 ,   9 ,  10 ,  10 ,  11 ,  11 ,  11 ,  12 ,
+	 12 ,  13 ,  13 ,  13 ,  14 ,  14 ,  15 ,  15 ,  16 ,  16 ,  17 ,  17 ,  18 ,  18 ,  19 ,  19 ,
+	 20 ,  20 ,  21 ,  22 ,  22 ,  23 ,  23 ,  24 ,  25 ,  25 ,  26 ,  26 ,  27 ,  28 ,  28 ,  29 ,
+	 30 ,  30 ,  31 ,  32 ,  33 ,  33 ,  34 ,  35 ,  35 ,  36 ,  37 ,  38 ,  39 ,  39 ,  40 ,  41 ,
+	 42 ,  43 ,  43 ,  44 ,  45 ,  46 ,  47 ,  48 ,  49 ,  49 ,  50 ,  51 ,  52 ,  53 ,  54 ,  55 ,
+	 56 ,  57 ,  58 ,  59 ,  60 ,  61 ,  62 ,  63 ,  64 ,  65 ,  66 ,  67 ,  68 ,  69 ,  70 ,  71 ,
+	 73 ,  74 ,  75 ,  76 ,  77 ,  78 ,  79 ,  81 ,  82 ,  83 ,  84 ,  85 ,  87 ,  88 ,  89 ,  90 ,
+	 91 ,  93 ,  94 ,  95 ,  97 ,  98 ,  99 , 100 , 102 , 103 , 105 , 106 , 107 , 109 , 110 , 111 ,
+	113 , 114 , 116 , 117 , 119 , 120 , 121 , 123 , 124 , 126 , 127 , 129 , 130 , 132 , 133 , 135 ,
+	137 , 138 , 140 , 141 , 143 , 145 , 146 , 148 , 149 , 151 , 153 , 154 , 156 , 158 , 159 , 161 ,
+	163 , 165 , 166 , 168 , 170 , 172 , 173 , 175 , 177 , 179 , 181 , 182 , 184 , 186 , 188 , 190 ,
+	192 , 194 , 196 , 197 , 199 , 201 , 203 , 205 , 207 , 209 , 211 , 213 , 215 , 217 , 219 , 221 ,
+	223 , 225 , 227 , 229 , 231 , 234 , 236 , 238 , 240 , 242 , 244 , 246 , 248 , 251 , 253 , 255
+};
+
+/**
+ * @brief Level that is shown now.
+ */
+static volatile uint8_t dimmer_level = 0;
+
+/**
+ * @brief Level the fade goes to.
+ */
+static volatile uint8_t dimmer_target = 0;
+
+/**
+ * @brief PWM periods per level step.
+ */
+static volatile uint8_t dimmer_rate = 1;
+
+/**
+ * @brief PWM periods left until the next step.
+ */
+static volatile uint8_t dimmer_count = 1;
+
+/**
+ * @brief Called from the overflow interrupt once per PWM period, may be 0.
+ *
+ * Keeps the overflow interrupt on while it is set. Set by soft_timer_init()
+ * when soft_timer.h shares timer 2.
+ */
+void (*dimmer_tick)(void) = 0;
+
+/**
+ * @brief Starts the PWM on OC2 with the light off.
+ */
+void dimmer_init(void)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		dimmer_level = 0;
+		dimmer_target = 0;
+		if ( !dimmer_tick )
+		{
+			T2_OVF_INT_OFF;
+		}
+		T2_CTC_INT_OFF;
+		T2_STOP;
+		T2_RESET;
+		T2_PHASE_PWM;
+		T2_PWM_DUTY( 0 );
+		T2_PWM_OUTPUT_ON;
+		T2_START_DIV( DIMMER_CLOCKDIVISION );
+	}
+}
+
+/**
+ * @brief Sets the brightness.
+ *
+ * Returns at once, a fade goes on in the overflow interrupt. A new call
+ * during a fade fades from the level reached so far.
+ *
+ * @param level brightness from 0 (off) to 255 (full).
+ * @param rate PWM periods per level step, 0 to change at once.
+ */
+void dimmer_set(uint8_t level, uint8_t rate)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		dimmer_target = level;
+		if ( rate == 0 || level == dimmer_level )
+		{
+			if ( !dimmer_tick )
+			{
+				T2_OVF_INT_OFF;
+			}
+			dimmer_level = level;
+			T2_PWM_DUTY( pgm_read_byte( &dimmer_gamma[ level ] ) );
+		}
+		else
+		{
+			dimmer_rate = rate;
+			dimmer_count = rate;
+			T2_OVF_INT_ON;
+		}
+	}
+}
+
+/**
+ * @brief Sets the brightness from the value of a configuration item.
+ *
+ * Fades in ::DIMMER_FADE_MS, values above 255 are full brightness.
+ *
+ * @param value value of ::DIMMER_CONFIG_ITEM.
+ */
+void dimmer_config(uint16_t value)
+{
+	dimmer_set( value > 255 ? 255 : value , DIMMER_FADE_RATE ? DIMMER_FADE_RATE : 1 );
+}
+
+/**
+ * @brief Tells if a fade is going on.
+ *
+ * @return 1 while the level moves, 0 when the target is reached.
+ */
+uint8_t dimmer_fading(void)
+{
+	return dimmer_level != dimmer_target;
+}
+
+/**
+ * @brief interrupt service routine for the fades and ::dimmer_tick, once per
+ *        PWM period
+ */
+ISR(TIMER2_OVF_vect)
+{
+	if ( dimmer_tick )
+	{
+		dimmer_tick();
+	}
+	/* Only still on for dimmer_tick. */
+	if ( dimmer_level == dimmer_target )
+	{
+		return;
+	}
+	if ( --dimmer_count )
+	{
+		return;
+	}
+	dimmer_count = dimmer_rate;
+	if ( dimmer_level < dimmer_target )
+	{
+		dimmer_level++;
+	}
+	else if ( dimmer_level > dimmer_target )
+	{
+		dimmer_level--;
+	}
+	T2_PWM_DUTY( pgm_read_byte( &dimmer_gamma[ dimmer_level ] ) );
+	if ( dimmer_level == dimmer_target && !dimmer_tick )
+	{
+		T2_OVF_INT_OFF;
+	}
+}
+
+#endif /* DIMMER_H_INCLUDED */
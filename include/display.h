@@ -17,47 +17,96 @@
 #ifndef DISPLAY_H_INCLUDED 
 #define DISPLAY_H_INCLUDED
 
+#ifndef LCD_RS
 /**
  * @brief LCD Register Select port number.
  *
  * @author Hannes
  */
 #define LCD_RS 2
+#endif
 
+#ifndef LCD_EN
 /**
  * @brief LCD port Enable port number.
  *
  * @author Hannes
  */
 #define LCD_EN 3
+#endif
+
+#ifdef LCD_RW
+/**
+ * @brief LCD Read/Write port number, only used in busy flag mode.
+ *
+ * This value is not defined by default, so R/W can be tied to ground and the
+ * display is driven with fixed timings. If it is defined before display.h is
+ * included, the busy flag mode is used: before each byte the busy flag of the
+ * ST7066 is read and the byte goes out as soon as the display is ready.
+ * \code
+ * #define LCD_RW 1 // PA1
+ * #include <include/display.h>
+ * \endcode
+ *
+ * @see lcd_wait_ready
+ */
+# define LCD_RW_BIT _BV( LCD_RW )
+#else
+# define LCD_RW_BIT 0
+#endif
+
+#ifndef LCD_BUSY_POLLS
+/**
+ * @brief Number of busy flag reads before the display is given up on.
+ *
+ * Each read takes a few microseconds, the default covers more than the 1.52 ms
+ * the slowest command needs. If the display does not answer, e.g. because
+ * nothing is connected, the writes go on after this many reads instead of
+ * hanging.
+ */
+# define LCD_BUSY_POLLS 1000
+#endif
 
+#ifndef LCD_D4
 /**
  * @brief LCD port Data4 port number.
  *
+ * The data pins can be overridden by defining them before display.h is
+ * included, e.g. for another board revision. If LCD_D4 to LCD_D7 are
+ * neighbouring pins in this order, a nibble is written with a single shift,
+ * otherwise through a table, see ::LCD_DATA_CONTIGUOUS.
+ *
  * @author Hannes
  */
 #define LCD_D4 4
+#endif
 
+#ifndef LCD_D5
 /**
  * @brief LCD port Data5 port number.
  *
  * @author Hannes
  */
 #define LCD_D5 5
+#endif
 
+#ifndef LCD_D6
 /**
  * @brief LCD port Data6 port number.
  *
  * @author Hannes
  */
 #define LCD_D6 6
+#endif
 
+#ifndef LCD_D7
 /**
  * @brief LCD port Data7 port number.
  *
  * @author Hannes
  */
 #define LCD_D7 7
+#endif
 
 
 /**
@@ -76,6 +125,13 @@
  */
 #define LCD_DDR DDRA
 
+/**
+ * @brief LCD input register, used to read the busy flag.
+ *
+ * @see LCD_RW
+ */
+#define LCD_PIN PINA
+
 #ifndef LCD_CLOCKDIVISION
 /**
  * @brief This is the clockdivision F_CPU is divided by.
@@ -89,13 +145,16 @@
  * @warning Only some values are valid. Pleas check ::T0_START  or 
  *          ::T1_START for more infotmations!
  *
+ * By default the smallest valid value is taken that lets timer 1 count the
+ * longest wait of the display, see lcd_timing.h.
+ *
  * @see LCD_EXTRA_DIV
  * @see LCD_TOP_DIV
  * @see T1_START
  * 
  * @author Hannes
  */
-# define LCD_CLOCKDIVISION 64
+# define LCD_CLOCKDIVISION LCD_AUTO_CLOCKDIVISION
 #endif
 
 #ifndef LCD_EXTRA_DIV
@@ -108,13 +167,16 @@
  * #include <include/display.h>
  * \endcode
  *
+ * By default the shortest enable pulse the display allows is taken, see
+ * lcd_timing.h.
+ *
  * @see LCD_CLOCKDIVISION
  * @see LCD_TOP_DIV
  * @see T1_CTC
  *
  * @author Hannes
  */
-# define LCD_EXTRA_DIV 10
+# define LCD_EXTRA_DIV LCD_AUTO_EXTRA_DIV
 #endif
 
 #ifndef LCD_TOP_DIV
@@ -127,16 +189,21 @@
  * #include <include/display.h>
  * \endcode
  *
+ * By default the shortest nibble the display allows is taken, see
+ * lcd_timing.h.
+ *
  * @see LCD_CLOCKDIVISION
  * @see LCD_EXTRA_DIV
  * @see T1_CTC
  *
  * @author Hannes
  */
-# define LCD_TOP_DIV 20
+# define LCD_TOP_DIV LCD_AUTO_TOP_DIV
 #endif
 
-/* This include must be after the definitions above. */
+/* These includes must be after the definitions above. lcd_timing.h fills in
+ * the default values and stops the build if the values are too fast. */
+#include <include/lcd_timing.h>
 #include <include/display_snippets.h>
 
 /**
@@ -159,6 +226,67 @@
  */
 #define LCD_MAX_CHARS_LINE 20
 
+/**
+ * @brief Reads the busy flag and the address counter of the display.
+ *
+ * D4 to D7 are switched to input for the read and back to output afterwards.
+ * The state of LCD_RS is kept.
+ *
+ * @pre ::LCD_RW must be defined, or this always returns 0.
+ *
+ * @return Busy flag in bit 7, address counter in bits 0 to 6.
+ */
+uint8_t lcd_read_status(void)
+{
+#ifdef LCD_RW
+	uint8_t status;
+	uint8_t rs = LCD_PORT & _BV( LCD_RS );
+
+	/* Data pins to input, without pull ups. */
+	LCD_DDR &= ~LCD_DATA_BITS;
+	LCD_PORT &= ~LCD_DATA_BITS;
+	LCD_CMD_MODE;
+	LCD_PORT |= _BV( LCD_RW );
+
+	/* High nibble, valid 160 ns after enable went high. */
+	LCD_PORT |= _BV( LCD_EN );
+	_delay_us(1);
+	status = LCD_DATA_READ_NIBBLE << 4;
+	LCD_PORT &= ~_BV( LCD_EN );
+	_delay_us(1);
+	/* Low nibble. */
+	LCD_PORT |= _BV( LCD_EN );
+	_delay_us(1);
+	status |= LCD_DATA_READ_NIBBLE;
+	LCD_PORT &= ~_BV( LCD_EN );
+
+	LCD_PORT &= ~_BV( LCD_RW );
+	LCD_DDR |= LCD_DATA_BITS;
+	LCD_PORT |= rs;
+	return status;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @brief Waits until the display can take the next byte.
+ *
+ * In busy flag mode this reads the busy flag until it is cleared, at most
+ * ::LCD_BUSY_POLLS times. With fixed timings this does nothing, the wait is
+ * part of the low phase of the enable clock.
+ *
+ * @see LCD_RW
+ */
+void lcd_wait_ready(void)
+{
+#ifdef LCD_RW
+	uint16_t polls = LCD_BUSY_POLLS;
+
+	while ( ( lcd_read_status() & 0x80 ) && --polls );
+#endif
+}
+
 /**
  * @brief Sends a nibble to the LCD
  *
@@ -290,6 +418,8 @@
 	LCD_WAIT_SETUP;\
 	/* Start the wait timer. */\
 	LCD_WAIT_TIMER_START;\
+	/* In busy flag mode, wait for the last byte to be done. */\
+	lcd_wait_ready();\
 	/* Setting up the data that should be send, high nibble. */\
 	LCD_DATA_SETUP_HIGH_NIBBLE( BYTE );\
 	/* Set clock high and wait. */\
@@ -413,17 +543,31 @@
 	}\
 }while(0)
 
+/**
+ * @brief Wait after the clear command.
+ *
+ * Empty in busy flag mode, see ::LCD_RW.
+ */
+#ifdef LCD_RW
+# define LCD_CLEAR_WAIT
+#else
+# define LCD_CLEAR_WAIT _delay_ms(2)
+#endif
+
 /**
  * @brief Clears the display
  *
  * The display will be cleared and the cursor set to the first position.
  *
+ * In busy flag mode the 2 ms wait is left out, the next byte waits for the
+ * display instead.
+ *
  * @pre The display must be first initialized for this macro to have
  *      some effect. This can be done with ::LCD_INIT.
  *
  * @author Hannes
  */
-#define LCD_CLEAR LCD_CMD_BYTE(  0x01 ); _delay_ms(2)
+#define LCD_CLEAR LCD_CMD_BYTE(  0x01 ); LCD_CLEAR_WAIT
 
 /**
  * @brief  Writes a string to the display
@@ -472,6 +616,8 @@ void lcd_write( char *display_text )
 	uint8_t char_position = 0;
 	for( ; char_position < display_text_lenght ; char_position++ )
 	{
+		/* In busy flag mode, wait for the last character to be done. */
+		lcd_wait_ready();
 		/* Setting up the data that should be send, high nibble. */
 		LCD_DATA_SETUP_HIGH_NIBBLE( display_text[ char_position ] );
 		/* Set clock high and wait. */
@@ -545,6 +691,8 @@ void lcd_write_line( char *line_text )
 	uint8_t char_position = 0;
 	for( ; char_position < line_text_lenght ; char_position++ )
 	{
+		/* In busy flag mode, wait for the last character to be done. */
+		lcd_wait_ready();
 		/* Setting up the data that should be send, high nibble. */
 		LCD_DATA_SETUP_HIGH_NIBBLE( line_text[ char_position ] );
 		/* Set clock high and wait. */
@@ -564,6 +712,8 @@ void lcd_write_line( char *line_text )
 	{
 		for( ; char_position < LCD_MAX_CHARS_LINE ; char_position++ )
 		{
+			/* In busy flag mode, wait for the last character to be done. */
+			lcd_wait_ready();
 			/* Setting up the data that should be send, high nibble. */
 			LCD_DATA_SETUP_HIGH_NIBBLE( ' ' );
 			/* Set clock high and wait. */
@@ -27,6 +27,7 @@
 #define LCD_PORT_SETUP (LCD_DDR |= (\
 				    _BV( LCD_RS )\
 				   |_BV( LCD_EN )\
+				   |LCD_RW_BIT\
 				   |_BV( LCD_D4 )\
 				   |_BV( LCD_D5 )\
 				   |_BV( LCD_D6 )\
@@ -34,6 +35,88 @@
 				   )\
 			)
 
+/**
+ * @brief Bits of ::LCD_PORT used for LCD_D4 to LCD_D7.
+ */
+#define LCD_DATA_BITS ( _BV( LCD_D4 ) | _BV( LCD_D5 ) | _BV( LCD_D6 ) | _BV( LCD_D7 ) )
+
+/**
+ * @brief 1 if LCD_D4 to LCD_D7 are four neighbouring pins in this order.
+ *
+ * Then a nibble can be written to ::LCD_PORT with one shift. Otherwise
+ * ::lcd_nibble_map is used.
+ */
+#if LCD_D5 == LCD_D4 + 1 && LCD_D6 == LCD_D4 + 2 && LCD_D7 == LCD_D4 + 3
+# define LCD_DATA_CONTIGUOUS 1
+#else
+# define LCD_DATA_CONTIGUOUS 0
+#endif
+
+#if LCD_DATA_CONTIGUOUS
+
+/**
+ * @brief Port bits for the lowest four bits of \b NIBBLE.
+ */
+#define LCD_NIBBLE_BITS( NIBBLE ) ( (uint8_t)( ( (NIBBLE) & 0x0F ) << LCD_D4 ) )
+
+/**
+ * @brief Reads a nibble from LCD_D4 to LCD_D7.
+ *
+ * @pre Pins LCD_D4 to LCD_D7 need to be setup as input and LCD_EN must be
+ * high.
+ */
+#define LCD_DATA_READ_NIBBLE ( ( LCD_PIN >> LCD_D4 ) & 0x0F )
+
+#else /* LCD_DATA_CONTIGUOUS */
+
+#include <avr/pgmspace.h>
+
+/**
+ * @brief Port bits for a nibble, worked out bit by bit.
+ *
+ * Only used at compile time to fill ::lcd_nibble_map.
+ */
+#define LCD_NIBBLE_MAP_ENTRY( NIBBLE ) ( \
+	  ( ( (NIBBLE) & _BV( 0 ) ) ? _BV( LCD_D4 ) : 0 )\
+	| ( ( (NIBBLE) & _BV( 1 ) ) ? _BV( LCD_D5 ) : 0 )\
+	| ( ( (NIBBLE) & _BV( 2 ) ) ? _BV( LCD_D6 ) : 0 )\
+	| ( ( (NIBBLE) & _BV( 3 ) ) ? _BV( LCD_D7 ) : 0 )\
+)
+
+/**
+ * @brief Port bits for every nibble, for data pins that are not neighbours.
+ */
+const uint8_t lcd_nibble_map[16] PROGMEM = {
+	LCD_NIBBLE_MAP_ENTRY( 0 ),  LCD_NIBBLE_MAP_ENTRY( 1 ),
+	LCD_NIBBLE_MAP_ENTRY( 2 ),  LCD_NIBBLE_MAP_ENTRY( 3 ),
+	LCD_NIBBLE_MAP_ENTRY( 4 ),  LCD_NIBBLE_MAP_ENTRY( 5 ),
+	LCD_NIBBLE_MAP_ENTRY( 6 ),  LCD_NIBBLE_MAP_ENTRY( 7 ),
+	LCD_NIBBLE_MAP_ENTRY( 8 ),  LCD_NIBBLE_MAP_ENTRY( 9 ),
+	LCD_NIBBLE_MAP_ENTRY( 10 ), LCD_NIBBLE_MAP_ENTRY( 11 ),
+	LCD_NIBBLE_MAP_ENTRY( 12 ), LCD_NIBBLE_MAP_ENTRY( 13 ),
+	LCD_NIBBLE_MAP_ENTRY( 14 ), LCD_NIBBLE_MAP_ENTRY( 15 )
+};
+
+/**
+ * @brief Port bits for the lowest four bits of \b NIBBLE.
+ */
+#define LCD_NIBBLE_BITS( NIBBLE ) pgm_read_byte( &lcd_nibble_map[ (NIBBLE) & 0x0F ] )
+
+/**
+ * @brief Reads a nibble from LCD_D4 to LCD_D7.
+ *
+ * @pre Pins LCD_D4 to LCD_D7 need to be setup as input and LCD_EN must be
+ * high.
+ */
+#define LCD_DATA_READ_NIBBLE ( \
+	  ( ( LCD_PIN & _BV( LCD_D4 ) ) ? _BV( 0 ) : 0 )\
+	| ( ( LCD_PIN & _BV( LCD_D5 ) ) ? _BV( 1 ) : 0 )\
+	| ( ( LCD_PIN & _BV( LCD_D6 ) ) ? _BV( 2 ) : 0 )\
+	| ( ( LCD_PIN & _BV( LCD_D7 ) ) ? _BV( 3 ) : 0 )\
+)
+
+#endif /* LCD_DATA_CONTIGUOUS */
+
 /**
  * @brief LCD will understand data as new charachter.
  *
@@ -58,35 +141,73 @@
  * @brief Sets up low nibble LCD data bits for the LCD.
  *
  * This should be set as early as possible before Enable ( LCD_EN ) goes high.
+ * All four data pins are written with one access to ::LCD_PORT.
  *
  * @pre Pins LCD_D4 to LCD_D7 need to be setup as output. ::LCD_PORT_SETUP can
  * be used to do so.
  *
  * @author Hannes
  */
-#define LCD_DATA_SETUP_LOW_NIBBLE( BYTE ) do{\
-	/* If BYTE bit  X  is set,     set also  LCD_DX          oterhwise clear bit  LCD_DX  .*/\
-	if( BYTE & _BV( 0 ) ) { LCD_PORT |= _BV( LCD_D4 ); } else { LCD_PORT &= ~_BV( LCD_D4 ); }\
-	if( BYTE & _BV( 1 ) ) { LCD_PORT |= _BV( LCD_D5 ); } else { LCD_PORT &= ~_BV( LCD_D5 ); }\
-	if( BYTE & _BV( 2 ) ) { LCD_PORT |= _BV( LCD_D6 ); } else { LCD_PORT &= ~_BV( LCD_D6 ); }\
-	if( BYTE & _BV( 3 ) ) { LCD_PORT |= _BV( LCD_D7 ); } else { LCD_PORT &= ~_BV( LCD_D7 ); }\
-}while(0)
+#define LCD_DATA_SETUP_LOW_NIBBLE( BYTE ) \
+	( LCD_PORT = ( LCD_PORT & ~LCD_DATA_BITS ) | LCD_NIBBLE_BITS( (BYTE) ) )
 
 /**
  * @brief Sets up high nibble LCD data bits for the LCD.
  *
  * This should be set as early as possible before Enable ( LCD_EN ) goes high.
+ * All four data pins are written with one access to ::LCD_PORT.
  *
  * @author Hannes
  */
-#define LCD_DATA_SETUP_HIGH_NIBBLE( BYTE ) do{\
-	/* If BYTE bit  X  is set,     set also  LCD_DX          oterhwise clear bit  LCD_DX  .*/\
-	if( BYTE & _BV( 4 ) ) { LCD_PORT |= _BV( LCD_D4 ); } else { LCD_PORT &= ~_BV( LCD_D4 ); }\
-	if( BYTE & _BV( 5 ) ) { LCD_PORT |= _BV( LCD_D5 ); } else { LCD_PORT &= ~_BV( LCD_D5 ); }\
-	if( BYTE & _BV( 6 ) ) { LCD_PORT |= _BV( LCD_D6 ); } else { LCD_PORT &= ~_BV( LCD_D6 ); }\
-	if( BYTE & _BV( 7 ) ) { LCD_PORT |= _BV( LCD_D7 ); } else { LCD_PORT &= ~_BV( LCD_D7 ); }\
+#define LCD_DATA_SETUP_HIGH_NIBBLE( BYTE ) \
+	( LCD_PORT = ( LCD_PORT & ~LCD_DATA_BITS ) | LCD_NIBBLE_BITS( (uint8_t)(BYTE) >> 4 ) )
+
+#ifdef LCD_RW
+
+/*
+ * Busy flag mode: the display tells when it is ready, see lcd_wait_ready().
+ * The enable clock only has to meet the minimum pulse widths of the ST7066
+ * (230 ns high, 500 ns cycle), timer 1 is not used.
+ */
+
+/**
+ * @brief Nothing to set up in busy flag mode.
+ */
+#define LCD_WAIT_SETUP do{}while(0)
+
+/**
+ * @brief Nothing to start in busy flag mode.
+ */
+#define LCD_WAIT_TIMER_START do{}while(0)
+
+/**
+ * @brief Nothing to stop in busy flag mode.
+ */
+#define LCD_WAIT_TIMER_STOP do{}while(0)
+
+/**
+ * @brief Nothing to clear in busy flag mode.
+ */
+#define LCD_WAIT_TIMER_RESET do{}while(0)
+
+/**
+ * @brief Sets LCD_EN high for the minimum pulse width.
+ */
+#define LCD_WAIT_CLK_HIGH do{\
+	LCD_PORT |= _BV( LCD_EN ); /* EN HIGH */\
+	_delay_us(1);\
 }while(0)
 
+/**
+ * @brief Sets LCD_EN low for the rest of the minimum cycle time.
+ */
+#define LCD_WAIT_CLK_LOW do{\
+	LCD_PORT &= ~_BV( LCD_EN ); /* EN LOW */\
+	_delay_us(1);\
+}while(0)
+
+#else /* LCD_RW */
+
 /**
  * @brief Sets the timer used for timing the wait cycles up.
  *
@@ -119,7 +240,7 @@
  *
  * @author Hannes
  */
-#define LCD_WAIT_TIMER_START T1_START( LCD_CLOCKDIVISION ) 
+#define LCD_WAIT_TIMER_START T1_START_DIV( LCD_CLOCKDIVISION )
 
 /**
  * @brief Stops the timer used for timing the wait cycles.
@@ -187,5 +308,7 @@
 	T1_COMP_MATCH_TOP_CLEAR;\
 }while(0)
 
+#endif /* LCD_RW */
+
 
 #endif /* DISPLAY_SNIPPETS_H_INCLUDED */
@@ -0,0 +1,223 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <stdint.h>
+#include <util/atomic.h>
+
+/** @file
+ * @brief Main loop that sleeps until an interrupt has work for it.
+ *
+ * Interrupts post events with event_post(), a bit each. event_wait() puts the
+ * CPU to sleep until at least one event is pending and returns all of them,
+ * event_dispatch() calls the handlers of a table for them. A handler that
+ * could not finish its work posts its event again, so the loop comes back
+ * without sleeping.
+ *
+ * The loop counts how often the CPU woke up and how much time it spent
+ * working and sleeping, measured with clock.h. Wakeups include interrupts
+ * that posted nothing, e.g. the display and clock interrupts on timer 1.
+ * The interrupt that ends a sleep runs before the CPU counts as busy again,
+ * so interrupt time is counted as idle.
+ *
+ * Example:
+ * \code
+ * const struct event_handler handlers[] = {
+ * 	{ EVENT_CARD | EVENT_READER , on_reader },
+ * 	{ EVENT_UART_RX , on_host },
+ * };
+ *
+ * clock_init();
+ * event_init();
+ * sei();
+ * event_post( EVENT_CARD );
+ * while(1)
+ * {
+ * 	event_dispatch( event_wait() , handlers , 2 );
+ * }
+ * \endcode
+ *
+ * @pre clock.h must be included before this file and clock_init() must have
+ *      been called.
+ */
+
+#ifndef EVENT_LOOP_H_INCLUDED
+#define EVENT_LOOP_H_INCLUDED
+
+/**
+ * @brief A card was put on or taken off the reader (INT0).
+ */
+#define EVENT_CARD 0x01
+
+/**
+ * @brief The UID read made progress, see ::rfid_read_event.
+ */
+#define EVENT_READER 0x02
+
+/**
+ * @brief The USART received a byte.
+ */
+#define EVENT_UART_RX 0x04
+
+/**
+ * @brief A software timer expired, posted by its callback.
+ */
+#define EVENT_TIMER 0x08
+
+/**
+ * @brief An entry of a handler table for event_dispatch().
+ */
+struct event_handler
+{
+	uint8_t events;                  /**< events the handler is called for */
+	void (*handle)(uint8_t events);  /**< called with the pending events */
+};
+
+/**
+ * @brief Counters of the event loop.
+ *
+ * @see event_get_stats
+ */
+struct event_stats
+{
+	uint32_t wakeups;      /**< times the CPU woke up from sleep */
+	uint32_t dispatches;   /**< times event_wait() returned events */
+	uint64_t busy_ticks;   /**< clock ticks spent outside of event_wait() */
+	uint64_t idle_ticks;   /**< clock ticks spent asleep */
+	uint32_t longest_busy; /**< longest time between two calls of event_wait() */
+};
+
+/**
+ * @brief Events that were posted and not yet returned by event_wait().
+ */
+static volatile uint8_t event_pending = 0;
+
+/**
+ * @brief Counters, reset by event_init().
+ */
+static struct event_stats event_counters;
+
+/**
+ * @brief Clock reading when event_wait() last returned.
+ */
+static uint32_t event_mark;
+
+/**
+ * @brief Sleep mode used by event_wait(), ::SLEEP_MODE_IDLE by default.
+ *
+ * A deeper mode may be set while nothing needs timer 1, timer 2 or the
+ * USART, which stop in all modes but idle unless timer 2 runs from a watch
+ * crystal. INT0 and INT1 only wake the CPU from power down and power save
+ * on a low level, not on an edge.
+ */
+uint8_t event_sleep_mode = SLEEP_MODE_IDLE;
+
+/**
+ * @brief Clears the pending events and resets the counters.
+ */
+void event_init(void)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		event_pending = 0;
+	}
+	event_counters.wakeups = 0;
+	event_counters.dispatches = 0;
+	event_counters.busy_ticks = 0;
+	event_counters.idle_ticks = 0;
+	event_counters.longest_busy = 0;
+	event_mark = clock_now();
+}
+
+/**
+ * @brief Posts events. Can be called from interrupts.
+ *
+ * @param events one or more of the EVENT_ bits.
+ */
+void event_post(uint8_t events)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		event_pending |= events;
+	}
+}
+
+/**
+ * @brief Sleeps until an event is pending.
+ *
+ * Returns at once if an event is pending already. Interrupts are only
+ * enabled again by the instruction before sleep, so an event posted after
+ * the check can not be slept through.
+ *
+ * @return the pending events, which are cleared.
+ */
+uint8_t event_wait(void)
+{
+	uint32_t now;
+	uint32_t busy;
+	uint8_t events;
+
+	busy = clock_elapsed( event_mark );
+	event_counters.busy_ticks += busy;
+	if ( busy > event_counters.longest_busy )
+	{
+		event_counters.longest_busy = busy;
+	}
+
+	cli();
+	while ( !event_pending )
+	{
+		now = clock_now();
+		set_sleep_mode( event_sleep_mode );
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+		cli();
+		event_counters.wakeups++;
+		event_counters.idle_ticks += clock_elapsed( now );
+	}
+	events = event_pending;
+	event_pending = 0;
+	sei();
+
+	event_mark = clock_now();
+	event_counters.dispatches++;
+	return events;
+}
+
+/**
+ * @brief Calls the handlers for events.
+ *
+ * Every handler whose \b events share a bit with \b events is called, in
+ * the order of the table.
+ *
+ * @param events events returned by event_wait().
+ * @param handlers handler table.
+ * @param count number of entries in \b handlers.
+ */
+void event_dispatch(uint8_t events, const struct event_handler *handlers, uint8_t count)
+{
+	uint8_t i;
+
+	for ( i = 0; i < count; i++ )
+	{
+		if ( handlers[i].events & events )
+		{
+			handlers[i].handle( events );
+		}
+	}
+}
+
+/**
+ * @brief Copies the counters of the event loop.
+ *
+ * The idle share is idle_ticks / ( busy_ticks + idle_ticks ).
+ *
+ * @param stats where the counters are copied to.
+ */
+void event_get_stats(struct event_stats *stats)
+{
+	*stats = event_counters;
+}
+
+#endif /* EVENT_LOOP_H_INCLUDED */
@@ -0,0 +1,303 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include <util/atomic.h>
+#include "ext_interrupt.h"
+
+/** @file
+ * @brief Queues the edges of the external interrupts for the main loop.
+ *
+ * A handler and a sense mode are attached to an interrupt line with
+ * ext_event_attach(). The interrupt only notes the line, the level of the
+ * pin and the time from clock.h in a queue, and calls ::ext_event_notify.
+ * ext_event_dispatch() is called from the main loop and hands the queued
+ * edges to the handlers, oldest first.
+ *
+ * Since every edge is queued, a card that is put on and taken away again
+ * while the main loop is busy, e.g. writing to the display, is seen as two
+ * edges in the right order. Reading the pin later would miss both.
+ *
+ * Only the lines in ::EXT_EVENT_LINES get an interrupt routine here. INT1 is
+ * left out by default, rfid_read.h has its own routine for DATA_READY,
+ * which has to go on with the SPI read inside the interrupt.
+ *
+ * Example:
+ * \code
+ * void on_card_edge(const struct ext_event *event)
+ * {
+ * 	if ( event->level )
+ * 	{ ... }
+ * }
+ *
+ * ext_event_notify = wake_main_loop;
+ * ext_event_attach( EXT_EVENT_INT0 , EXT_EVENT_CHANGE , on_card_edge );
+ * ...
+ * ext_event_dispatch();
+ * \endcode
+ *
+ * @pre clock.h must be included before this file and clock_init() must have
+ *      been called.
+ */
+
+#ifndef EXT_EVENT_H_INCLUDED
+#define EXT_EVENT_H_INCLUDED
+
+#define EXT_EVENT_INT0 0 /**< line INT0, PD2 */
+#define EXT_EVENT_INT1 1 /**< line INT1, PD3 */
+#define EXT_EVENT_INT2 2 /**< line INT2, PB2 */
+
+#define EXT_EVENT_CHANGE  1 /**< both edges, not on INT2 */
+#define EXT_EVENT_FALLING 2 /**< falling edges */
+#define EXT_EVENT_RISING  3 /**< rising edges */
+
+#ifndef EXT_EVENT_LINES
+/**
+ * @brief Lines that get an interrupt routine here, one bit per line.
+ *
+ * Bit 0 is INT0, bit 1 INT1 and bit 2 INT2. Can be overridden by defining
+ * it before this file is included.
+ */
+#define EXT_EVENT_LINES 0x05
+#endif
+
+#ifndef EXT_EVENT_QUEUE_SIZE
+/**
+ * @brief Size of the edge queue in entries.
+ *
+ * Must be a power of two not bigger than 128. One entry is kept free, so
+ * the queue holds one edge less. Can be overridden by defining it before
+ * this file is included.
+ */
+#define EXT_EVENT_QUEUE_SIZE 8
+#endif
+
+#if ( EXT_EVENT_QUEUE_SIZE & ( EXT_EVENT_QUEUE_SIZE - 1 ) ) || EXT_EVENT_QUEUE_SIZE > 128
+#error "EXT_EVENT_QUEUE_SIZE must be a power of two not bigger than 128"
+#endif
+
+/**
+ * @brief Mask for wrapping the queue indices.
+ */
+#define EXT_EVENT_QUEUE_MASK ( EXT_EVENT_QUEUE_SIZE - 1 )
+
+/**
+ * @brief An edge of an external interrupt.
+ */
+struct ext_event
+{
+	uint32_t time; /**< clock_now() in the interrupt */
+	uint8_t line;  /**< EXT_EVENT_INT0 .. EXT_EVENT_INT2 */
+	uint8_t level; /**< level of the pin in the interrupt, 0 or 1 */
+};
+
+/**
+ * @brief Handler of a line, called by ext_event_dispatch().
+ */
+typedef void (*ext_event_handler)(const struct ext_event *event);
+
+/**
+ * @brief Called from the interrupts after an edge was queued, may be 0.
+ *
+ * Lets the main loop know that ext_event_dispatch() has work, e.g. to wake
+ * it up.
+ */
+void (*ext_event_notify)(void) = 0;
+
+/**
+ * @brief Edges that were lost because the queue was full.
+ */
+volatile uint16_t ext_event_overflows = 0;
+
+/**
+ * @brief Handler of each line, 0 if none is attached.
+ */
+static ext_event_handler ext_event_handlers[ 3 ];
+
+/**
+ * @brief The edge queue, filled by the interrupts.
+ */
+static struct ext_event ext_event_queue[ EXT_EVENT_QUEUE_SIZE ];
+
+/**
+ * @brief Index of the next free entry. Only written by the interrupts.
+ */
+static volatile uint8_t ext_event_head = 0;
+
+/**
+ * @brief Index of the next entry to dispatch. Only written by the main loop.
+ */
+static volatile uint8_t ext_event_tail = 0;
+
+/**
+ * @brief Disables the interrupt of a line.
+ */
+static void ext_event_disable(uint8_t line)
+{
+	switch ( line )
+	{
+		case EXT_EVENT_INT0: EXT_INT0_DIS; break;
+		case EXT_EVENT_INT1: EXT_INT1_DIS; break;
+		default: EXT_INT2_DIS; break;
+	}
+}
+
+/**
+ * @brief Attaches a handler to a line and enables its interrupt.
+ *
+ * A handler that was attached before is replaced. Edges from before the
+ * call are not queued.
+ *
+ * @param line ::EXT_EVENT_INT0, ::EXT_EVENT_INT1 or ::EXT_EVENT_INT2, which
+ *             must be in ::EXT_EVENT_LINES.
+ * @param sense ::EXT_EVENT_CHANGE, ::EXT_EVENT_FALLING or ::EXT_EVENT_RISING.
+ *              INT2 takes ::EXT_EVENT_CHANGE as rising.
+ * @param handler called from ext_event_dispatch() for every edge.
+ */
+void ext_event_attach(uint8_t line, uint8_t sense, ext_event_handler handler)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		ext_event_disable( line );
+		ext_event_handlers[ line ] = handler;
+		switch ( line )
+		{
+			case EXT_EVENT_INT0:
+				if ( sense == EXT_EVENT_CHANGE ) { EXT_INT0_CHANGE; }
+				else if ( sense == EXT_EVENT_FALLING ) { EXT_INT0_FALLING; }
+				else { EXT_INT0_RISING; }
+				EXT_INT0_CLEAR;
+				EXT_INT0_EN;
+				break;
+			case EXT_EVENT_INT1:
+				if ( sense == EXT_EVENT_CHANGE ) { EXT_INT1_CHANGE; }
+				else if ( sense == EXT_EVENT_FALLING ) { EXT_INT1_FALLING; }
+				else { EXT_INT1_RISING; }
+				EXT_INT1_CLEAR;
+				EXT_INT1_EN;
+				break;
+			default:
+				if ( sense == EXT_EVENT_FALLING ) { EXT_INT2_FALLING; }
+				else { EXT_INT2_RISING; }
+				EXT_INT2_CLEAR;
+				EXT_INT2_EN;
+				break;
+		}
+	}
+}
+
+/**
+ * @brief Disables the interrupt of a line and removes its handler.
+ *
+ * Edges of the line that are still queued are dropped by
+ * ext_event_dispatch().
+ *
+ * @param line line given to ext_event_attach().
+ */
+void ext_event_detach(uint8_t line)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		ext_event_disable( line );
+		ext_event_handlers[ line ] = 0;
+	}
+}
+
+/**
+ * @brief Takes the oldest edge out of the queue.
+ *
+ * Only the interrupts move the head and only this function moves the tail,
+ * so no interrupts need to be disabled.
+ *
+ * @param event where the edge is copied to.
+ *
+ * @return 1 if an edge was read, 0 if the queue was empty.
+ */
+uint8_t ext_event_read(struct ext_event *event)
+{
+	uint8_t tail = ext_event_tail;
+
+	if ( tail == ext_event_head )
+	{
+		return 0;
+	}
+	*event = ext_event_queue[ tail ];
+	/* Hand the entry back to the interrupts. */
+	ext_event_tail = ( tail + 1 ) & EXT_EVENT_QUEUE_MASK;
+
+	return 1;
+}
+
+/**
+ * @brief Hands all queued edges to the handlers of their lines.
+ *
+ * Edges that come in meanwhile are handed over in the same call.
+ */
+void ext_event_dispatch(void)
+{
+	struct ext_event event;
+	ext_event_handler handler;
+
+	while ( ext_event_read( &event ) )
+	{
+		handler = ext_event_handlers[ event.line ];
+		if ( handler )
+		{
+			handler( &event );
+		}
+	}
+}
+
+/**
+ * @brief Queues an edge, called by the interrupts.
+ */
+static void ext_event_push(uint8_t line, uint8_t level)
+{
+	uint8_t head = ext_event_head;
+	uint8_t next = ( head + 1 ) & EXT_EVENT_QUEUE_MASK;
+
+	if ( next == ext_event_tail )
+	{
+		ext_event_overflows++;
+		return;
+	}
+	ext_event_queue[ head ].time = clock_now();
+	ext_event_queue[ head ].line = line;
+	ext_event_queue[ head ].level = level;
+	ext_event_head = next;
+	if ( ext_event_notify )
+	{
+		ext_event_notify();
+	}
+}
+
+#if EXT_EVENT_LINES & 0x01
+/**
+ * @brief interrupt service routine for INT0
+ */
+ISR(INT0_vect)
+{
+	ext_event_push( EXT_EVENT_INT0 , ( PIND >> PD2 ) & 1 );
+}
+#endif
+
+#if EXT_EVENT_LINES & 0x02
+/**
+ * @brief interrupt service routine for INT1
+ */
+ISR(INT1_vect)
+{
+	ext_event_push( EXT_EVENT_INT1 , ( PIND >> PD3 ) & 1 );
+}
+#endif
+
+#if EXT_EVENT_LINES & 0x04
+/**
+ * @brief interrupt service routine for INT2
+ */
+ISR(INT2_vect)
+{
+	ext_event_push( EXT_EVENT_INT2 , ( PINB >> PB2 ) & 1 );
+}
+#endif
+
+#endif /* EXT_EVENT_H_INCLUDED */
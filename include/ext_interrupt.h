@@ -15,6 +15,11 @@
  * @see EXT_INT1_DIS
  * @see EXT_INT1_RISING
  * @see EXT_INT1_FALLING
+ * @see EXT_INT0_CLEAR
+ * @see EXT_INT1_CLEAR
+ * @see EXT_INT0_CHANGE
+ * @see EXT_INT1_CHANGE
+ * @see EXT_INT2_EN
  *
 */
 
@@ -96,6 +101,19 @@
  #define EXT_INT1_DIS GICR &= ~( 1<<INT1 ) /* Making sure INT1 is set to a 0 => disabled */
 
 
+/**
+ * @brief Clears a pending external interrupt 1
+ *
+ * Macro for clearing the External Interrupt Flag 1. Changing the sense
+ * control can set the flag, so it should be cleared before the interrupt is
+ * enabled, otherwise the ISR runs at once for an edge that is long gone.
+ *
+ * @see EXT_INT1_EN
+ *
+ */
+#define EXT_INT1_CLEAR GIFR = ( 1<<INTF1 ) /* Writing a 1 clears INTF1 */
+
+
 
 
 
@@ -157,7 +175,7 @@
  * @see EXT_INT0_FALLING
  *
  */
-#define EXT_INT0_EN  GICR |= ( 1<<INT1 ) /* Setting INT0 to 1 => enable */
+#define EXT_INT0_EN  GICR |= ( 1<<INT0 ) /* Setting INT0 to 1 => enable */
 
 
 /**
@@ -172,7 +190,110 @@
  * @see EXT_INT0_FALLING
  *
  */
- #define EXT_INT0_DIS GICR &= ~( 1<<INT1 ) /* Making sure INT0 is set to a 0 => disabled */
+ #define EXT_INT0_DIS GICR &= ~( 1<<INT0 ) /* Making sure INT0 is set to a 0 => disabled */
+
+
+/**
+ * @brief Clears a pending external interrupt 0
+ *
+ * Macro for clearing the External Interrupt Flag 0. Changing the sense
+ * control can set the flag, so it should be cleared before the interrupt is
+ * enabled, otherwise the ISR runs at once for an edge that is long gone.
+ *
+ * @see EXT_INT0_EN
+ *
+ */
+#define EXT_INT0_CLEAR GIFR = ( 1<<INTF0 ) /* Writing a 1 clears INTF0 */
+
+
+/**
+ * @brief Set up external interrupt 1 on any logical change
+ *
+ * Both edges raise the interrupt, the ISR can tell them apart by reading
+ * the pin.
+ *
+ * @see EXT_INT1_EN
+ * @see EXT_INT1_RISING
+ * @see EXT_INT1_FALLING
+ *
+ */
+#define EXT_INT1_CHANGE do{ 	\
+								\
+	MCUCR &= ~(1<<ISC11); /* Resetting ISC11 (3rd bit) to 0 */		\
+	MCUCR |= (1<<ISC10); /* Setting ISC10 (2nd bit) to 1 */		\
+								\
+}while(0)
+
+
+/**
+ * @brief Set up external interrupt 0 on any logical change
+ *
+ * Both edges raise the interrupt, the ISR can tell them apart by reading
+ * the pin.
+ *
+ * @see EXT_INT0_EN
+ * @see EXT_INT0_RISING
+ * @see EXT_INT0_FALLING
+ *
+ */
+#define EXT_INT0_CHANGE do{ 	\
+								\
+	MCUCR &= ~(1<<ISC01); /* Resetting ISC01 (1st bit) to 0 */		\
+	MCUCR |= (1<<ISC00); /* Setting ISC00 (0th bit) to 1 */		\
+								\
+}while(0)
+
+
+/**
+ * @brief Set up external interrupt 2 on a Rising edge
+ *
+ * INT2 (PB2) only knows rising and falling edges. Changing the edge can
+ * raise the interrupt, so INT2 should be disabled while it is changed and
+ * the flag cleared afterwards.
+ *
+ * @see EXT_INT2_EN
+ * @see EXT_INT2_CLEAR
+ *
+ */
+#define EXT_INT2_RISING ( MCUCSR |= (1<<ISC2) ) /* Setting ISC2 to 1 */
+
+
+/**
+ * @brief Set up external interrupt 2 on a Falling edge
+ *
+ * @see EXT_INT2_RISING
+ *
+ */
+#define EXT_INT2_FALLING ( MCUCSR &= ~(1<<ISC2) ) /* Resetting ISC2 to 0 */
+
+
+/**
+ * @brief Enables external interrupt 2
+ *
+ * @see EXT_INT2_DIS
+ * @see EXT_INT2_RISING
+ * @see EXT_INT2_FALLING
+ *
+ */
+#define EXT_INT2_EN  GICR |= ( 1<<INT2 ) /* Setting INT2 to 1 => enable */
+
+
+/**
+ * @brief Disables external interrupt 2
+ *
+ * @see EXT_INT2_EN
+ *
+ */
+#define EXT_INT2_DIS GICR &= ~( 1<<INT2 ) /* Making sure INT2 is set to a 0 => disabled */
+
+
+/**
+ * @brief Clears a pending external interrupt 2
+ *
+ * @see EXT_INT0_CLEAR
+ *
+ */
+#define EXT_INT2_CLEAR GIFR = ( 1<<INTF2 ) /* Writing a 1 clears INTF2 */
 
 
 #endif /* EXT_INTERRUPT_H_INCLUDED */
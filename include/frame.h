@@ -0,0 +1,181 @@
+#include <stdint.h>
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+/* Host builds (tests) keep the table in normal memory. */
+#define PROGMEM
+#define pgm_read_word( ADDRESS ) ( *( ADDRESS ) )
+#endif
+
+/**
+ * @file
+ * @brief Binary frames for the serial link between reader and HACS server.
+ *
+ * Every message on the serial link is sent as one frame:
+ *
+ * <table border="1">
+ * 	<tr><th>Byte</th><th>Content</th></tr>
+ * 	<tr><td>0</td><td>::FRAME_SYNC</td></tr>
+ * 	<tr><td>1</td><td>type, see FRAME_TYPE_*</td></tr>
+ * 	<tr><td>2</td><td>payload length n, at most ::FRAME_MAX_PAYLOAD</td></tr>
+ * 	<tr><td>3</td><td>sequence number</td></tr>
+ * 	<tr><td>4 .. 3+n</td><td>payload</td></tr>
+ * 	<tr><td>4+n, 5+n</td><td>CRC-16, high byte first</td></tr>
+ * </table>
+ *
+ * The CRC is CRC-16/CCITT (polynomial 0x1021, start value 0xFFFF, no
+ * reflection, no final xor) over the bytes 1 to 3+n, so the sync byte is not
+ * part of it. The host can find the start of a frame by looking for
+ * ::FRAME_SYNC and then knows the frame length from byte 2, no text has to be
+ * scanned. Payload bytes may have any value, including 0x00.
+ *
+ * @see frame_send
+ */
+
+#ifndef FRAME_H_INCLUDED
+#define FRAME_H_INCLUDED
+
+/**
+ * @brief First byte of every frame.
+ */
+#define FRAME_SYNC 0xA5
+
+/**
+ * @brief Bytes in a frame that are not payload (sync, type, length,
+ *        sequence number and CRC).
+ */
+#define FRAME_OVERHEAD 6
+
+/**
+ * @brief Biggest payload a frame can carry.
+ *
+ * Chosen so that a complete frame fits into the default UART transmit
+ * buffer.
+ */
+#define FRAME_MAX_PAYLOAD 24
+
+/**
+ * @brief Frame type: UID of a card that was read, reader to host.
+ *
+ * The payload is the raw card UID as read from the RFID module.
+ */
+#define FRAME_TYPE_CARD_UID 0x01
+
+/**
+ * @brief Frame type: write one line of the LCD, host to reader.
+ *
+ * Payload: line number (1 to 4) followed by at most 20 characters.
+ */
+#define FRAME_TYPE_LCD_LINE 0x10
+
+/**
+ * @brief Frame type: clear the LCD, host to reader. No payload.
+ */
+#define FRAME_TYPE_LCD_CLEAR 0x11
+
+/**
+ * @brief Frame type: apply one room configuration item, host to reader.
+ *
+ * Payload: item number followed by the 16 bit value, high byte first.
+ */
+#define FRAME_TYPE_CONFIG_ITEM 0x12
+
+/**
+ * @brief Frame type: acknowledge of a reader frame, host to reader.
+ *
+ * Payload: sequence number of the acknowledged frame.
+ */
+#define FRAME_TYPE_ACK 0x13
+
+/**
+ * @brief Lookup table for CRC-16/CCITT, one entry per nibble.
+ *
+ * Two lookups per byte keep the table at 32 bytes of flash instead of the 512
+ * bytes a byte wise table would need.
+ */
+const uint16_t crc16_nibble_table[16] PROGMEM = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/**
+ * @brief Adds one byte to a CRC-16/CCITT.
+ *
+ * Start with 0xFFFF and feed every byte through this function.
+ *
+ * @param crc CRC of the bytes so far.
+ * @param data next byte.
+ *
+ * @return CRC including \b data.
+ */
+uint16_t crc16_update(uint16_t crc, uint8_t data)
+{
+	/* High nibble first, then low nibble. */
+	crc = ( crc << 4 ) ^ pgm_read_word( &crc16_nibble_table[ ( crc >> 12 ) ^ ( data >> 4 ) ] );
+	crc = ( crc << 4 ) ^ pgm_read_word( &crc16_nibble_table[ ( crc >> 12 ) ^ ( data & 0x0F ) ] );
+	return crc;
+}
+
+/**
+ * @brief Sequence number of the next frame sent.
+ *
+ * Only increased when a frame was actually queued, so the host can detect
+ * lost frames by gaps.
+ */
+uint8_t frame_sequence = 0;
+
+/**
+ * @brief Builds a frame and queues it for sending.
+ *
+ * The frame is handed to uart_tx_write() as one block. If the transmit buffer
+ * has not enough room, nothing is sent and 0 is returned; the caller can try
+ * again later, e.g. in the next pass of the state machine. Such a refusal is
+ * not counted in ::uart_tx_dropped, the frame is not lost as long as the
+ * caller tries again.
+ *
+ * @pre uart_driver.h must be included before this file.
+ *
+ * @param type frame type, see FRAME_TYPE_*.
+ * @param payload payload bytes, may contain 0x00.
+ * @param length number of payload bytes, at most ::FRAME_MAX_PAYLOAD.
+ *
+ * @return 1 if the frame was queued, 0 otherwise.
+ */
+uint8_t frame_send(uint8_t type, const uint8_t *payload, uint8_t length)
+{
+	uint8_t frame[ FRAME_MAX_PAYLOAD + FRAME_OVERHEAD ];
+	uint16_t crc = 0xFFFF;
+	uint8_t i;
+
+	if ( length > FRAME_MAX_PAYLOAD )
+	{
+		return 0;
+	}
+	/* Check first, a refused uart_tx_write() would count as dropped. */
+	if ( uart_tx_free() < length + FRAME_OVERHEAD )
+	{
+		return 0;
+	}
+
+	frame[0] = FRAME_SYNC;
+	frame[1] = type;
+	frame[2] = length;
+	frame[3] = frame_sequence;
+	for ( i = 0; i < length; i++ )
+	{
+		frame[ 4 + i ] = payload[ i ];
+	}
+	/* CRC over everything but the sync byte. */
+	for ( i = 1; i < length + 4; i++ )
+	{
+		crc = crc16_update( crc, frame[ i ] );
+	}
+	frame[ length + 4 ] = crc >> 8;
+	frame[ length + 5 ] = crc & 0xFF;
+
+	uart_tx_write( frame, length + FRAME_OVERHEAD );
+	frame_sequence++;
+	return 1;
+}
+
+#endif /* FRAME_H_INCLUDED */
@@ -0,0 +1,198 @@
+#include <stdint.h>
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+/* Host builds (tests) keep the tables in normal memory. */
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#ifndef pgm_read_byte
+#define pgm_read_byte( ADDRESS ) ( *( ADDRESS ) )
+#endif
+#endif
+
+/** @file
+ * @brief State machines driven by a state x event table in flash.
+ *
+ * A state machine is described by two constant tables. The transition table
+ * has a cell for every state and event, which holds the next state and an
+ * action. The state table holds an entry and an exit action for every
+ * state. fsm_dispatch() finds the cell of the current state and the event
+ * by its index, so it takes the same time for any number of states.
+ *
+ * Cells that are not set by the table ignore the event. A transition to
+ * the same state is internal: only its action runs, not the exit and entry
+ * actions.
+ *
+ * Actions return an event, or ::FSM_NO_EVENT. The event is dispatched right
+ * after the transition, before fsm_dispatch() returns. An entry action can
+ * so e.g. check a pin after arming its interrupt, and a transition action
+ * can report the result of an operation.
+ *
+ * Example:
+ * \code
+ * #define DOOR_CLOSED 0
+ * #define DOOR_OPEN   1
+ * #define DOOR_STATES 2
+ *
+ * #define DOOR_EV_PUSH 0
+ * #define DOOR_EVENTS  1
+ *
+ * const struct fsm_transition door_table[ DOOR_STATES ][ DOOR_EVENTS ] PROGMEM = {
+ * 	[ DOOR_CLOSED ][ DOOR_EV_PUSH ] = FSM_GO( DOOR_OPEN , 0 ),
+ * 	[ DOOR_OPEN ][ DOOR_EV_PUSH ] = FSM_GO( DOOR_CLOSED , 0 ),
+ * };
+ * const struct fsm_state door_states[ DOOR_STATES ] PROGMEM = {
+ * 	[ DOOR_OPEN ] = { door_light_on , door_light_off },
+ * };
+ * struct fsm door = FSM_INIT( door_table , door_states , DOOR_EVENTS );
+ *
+ * fsm_start( &door , DOOR_CLOSED );
+ * fsm_dispatch( &door , DOOR_EV_PUSH );
+ * \endcode
+ */
+
+#ifndef FSM_H_INCLUDED
+#define FSM_H_INCLUDED
+
+/**
+ * @brief Returned by actions that do not cause another event.
+ */
+#define FSM_NO_EVENT 0xFF
+
+/**
+ * @brief An entry, exit or transition action.
+ *
+ * @return the next event to dispatch, or ::FSM_NO_EVENT.
+ */
+typedef uint8_t (*fsm_action)(void);
+
+/**
+ * @brief A cell of the transition table.
+ *
+ * Use ::FSM_GO to fill it, an empty cell ignores the event.
+ */
+struct fsm_transition
+{
+	uint8_t next;      /**< next state plus 1, 0 if the event is ignored */
+	fsm_action action; /**< transition action, or 0 */
+};
+
+/**
+ * @brief Actions of a state.
+ */
+struct fsm_state
+{
+	fsm_action entry; /**< run when the state is entered, or 0 */
+	fsm_action exit;  /**< run when the state is left, its event is ignored, or 0 */
+};
+
+/**
+ * @brief Describes a transition in a table.
+ *
+ * @param NEXT next state.
+ * @param ACTION transition action, or 0.
+ */
+#define FSM_GO( NEXT , ACTION ) { (NEXT) + 1 , (ACTION) }
+
+/**
+ * @brief A state machine and its tables.
+ */
+struct fsm
+{
+	const struct fsm_transition *table; /**< transition table in flash, one row per state */
+	const struct fsm_state *states;     /**< state table in flash */
+	uint8_t events;                     /**< number of events, the length of a row */
+	uint8_t state;                      /**< current state */
+	/** Called for every transition before its actions run, or 0. */
+	void (*trace)(uint8_t state, uint8_t event, uint8_t next);
+};
+
+/**
+ * @brief Initializer of a struct fsm.
+ *
+ * @param TABLE transition table, an array [states][EVENTS].
+ * @param STATES state table.
+ * @param EVENTS number of events.
+ */
+#define FSM_INIT( TABLE , STATES , EVENTS ) \
+	{ &(TABLE)[0][0] , (STATES) , (EVENTS) , 0 , 0 }
+
+/**
+ * @brief Reads an action from flash.
+ */
+#ifdef __AVR__
+#define FSM_READ_ACTION( ADDRESS ) ( (fsm_action)pgm_read_word( ADDRESS ) )
+#else
+#define FSM_READ_ACTION( ADDRESS ) ( *( ADDRESS ) )
+#endif
+
+/**
+ * @brief Runs an action.
+ *
+ * @return the event returned by the action, ::FSM_NO_EVENT if there is no
+ *         action.
+ */
+static uint8_t fsm_run(fsm_action action)
+{
+	return action ? action() : FSM_NO_EVENT;
+}
+
+/**
+ * @brief Dispatches an event and the events the actions return.
+ *
+ * If the entry action and the transition action both return an event, the
+ * one of the entry action is taken.
+ *
+ * @param fsm the state machine.
+ * @param event event number, less than \b fsm->events.
+ */
+void fsm_dispatch(struct fsm *fsm, uint8_t event)
+{
+	const struct fsm_transition *cell;
+	uint8_t next;
+	uint8_t entry_event;
+
+	while ( event != FSM_NO_EVENT )
+	{
+		cell = &fsm->table[ (uint16_t)fsm->state * fsm->events + event ];
+		next = pgm_read_byte( &cell->next );
+		if ( next == 0 )
+		{
+			return;
+		}
+		next--;
+		if ( fsm->trace )
+		{
+			fsm->trace( fsm->state , event , next );
+		}
+		if ( next != fsm->state )
+		{
+			fsm_run( FSM_READ_ACTION( &fsm->states[ fsm->state ].exit ) );
+		}
+		event = fsm_run( FSM_READ_ACTION( &cell->action ) );
+		if ( next != fsm->state )
+		{
+			fsm->state = next;
+			entry_event = fsm_run( FSM_READ_ACTION( &fsm->states[ next ].entry ) );
+			if ( entry_event != FSM_NO_EVENT )
+			{
+				event = entry_event;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Sets the first state and runs its entry action.
+ *
+ * @param fsm the state machine.
+ * @param state first state.
+ */
+void fsm_start(struct fsm *fsm, uint8_t state)
+{
+	fsm->state = state;
+	fsm_dispatch( fsm , fsm_run( FSM_READ_ACTION( &fsm->states[ state ].entry ) ) );
+}
+
+#endif /* FSM_H_INCLUDED */
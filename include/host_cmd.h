@@ -0,0 +1,279 @@
+#include <stdint.h>
+#include "frame.h"
+
+/**
+ * @file
+ * @brief Parser and dispatcher for frames sent by the HACS server.
+ *
+ * The server answers a card event with frames that tell the reader what to
+ * display and how to set up the room (use case UC1). The frames have the
+ * layout described in frame.h.
+ *
+ * The parser is incremental: bytes are fed one at a time and it never waits
+ * for the rest of a frame. Payload bytes are copied once, from the UART
+ * receive buffer into the payload buffer of the parser. The CRC is checked
+ * on the way and the payload is handed to its handler from there. The byte
+ * after the payload is set to 0, so handlers can use text payloads as
+ * strings without copying them again.
+ *
+ * Parsing in place in the receive buffer was not done. A frame of up to 30
+ * bytes wraps around the 32 byte ring, so handlers would get the payload in
+ * two parts. The ring would also have to hold every byte of a frame until
+ * its handler returned, which leaves almost no room for the next frame.
+ * And the 0 after the payload would have to be written into a slot that
+ * belongs to the receive interrupt. The copy costs 25 bytes of RAM and one
+ * store per payload byte.
+ *
+ * Typical use in the main loop:
+ * \code
+ * static const struct host_cmd_handler handlers[] = {
+ * 	{ FRAME_TYPE_LCD_CLEAR , on_lcd_clear },
+ * 	...
+ * };
+ * struct host_cmd_parser parser;
+ *
+ * host_cmd_init( &parser );
+ * while(1)
+ * {
+ * 	host_cmd_poll( &parser , handlers , 4 , HOST_CMD_BUDGET );
+ * 	...
+ * }
+ * \endcode
+ *
+ * @pre uart_driver.h must be included before this file.
+ */
+
+#ifndef HOST_CMD_H_INCLUDED
+#define HOST_CMD_H_INCLUDED
+
+#ifndef HOST_CMD_BUDGET
+/**
+ * @brief Default number of received bytes handled per host_cmd_poll() call.
+ *
+ * Keeps the time spent in the parser per main loop pass bounded, so the
+ * reader state machine is not starved when the server sends a lot of data.
+ * Can be overridden by defining it before this file is included.
+ */
+#define HOST_CMD_BUDGET 8
+#endif
+
+/**
+ * @brief Parser waits for ::FRAME_SYNC.
+ */
+#define HOST_CMD_WAIT_SYNC 0
+
+/**
+ * @brief Parser waits for the type byte.
+ */
+#define HOST_CMD_TYPE 1
+
+/**
+ * @brief Parser waits for the length byte.
+ */
+#define HOST_CMD_LENGTH 2
+
+/**
+ * @brief Parser waits for the sequence number.
+ */
+#define HOST_CMD_SEQUENCE 3
+
+/**
+ * @brief Parser collects payload bytes.
+ */
+#define HOST_CMD_PAYLOAD 4
+
+/**
+ * @brief Parser waits for the high byte of the CRC.
+ */
+#define HOST_CMD_CRC_HIGH 5
+
+/**
+ * @brief Parser waits for the low byte of the CRC.
+ */
+#define HOST_CMD_CRC_LOW 6
+
+/**
+ * @brief Handler for one frame type.
+ *
+ * @see host_cmd_dispatch
+ */
+struct host_cmd_handler
+{
+	uint8_t type; /**< frame type, see FRAME_TYPE_* */
+	/** called with the payload (followed by a 0 byte) and its length */
+	void (*handle)(const uint8_t *payload, uint8_t length);
+};
+
+/**
+ * @brief State of one parser.
+ */
+struct host_cmd_parser
+{
+	uint8_t state;    /**< one of HOST_CMD_WAIT_SYNC .. HOST_CMD_CRC_LOW */
+	uint8_t type;     /**< type of the frame being received */
+	uint8_t length;   /**< payload length of the frame being received */
+	uint8_t sequence; /**< sequence number of the frame being received */
+	uint8_t index;    /**< payload bytes received so far */
+	uint16_t crc;     /**< running CRC of the frame being received */
+	uint8_t crc_high; /**< received high byte of the CRC */
+	/** payload of the frame being received, plus the terminating 0 */
+	uint8_t payload[ FRAME_MAX_PAYLOAD + 1 ];
+
+	uint16_t frames;        /**< valid frames received */
+	uint16_t crc_errors;    /**< frames dropped because of a wrong CRC */
+	uint16_t length_errors; /**< frames dropped because they were too long */
+	uint16_t unknown_types; /**< valid frames without handler */
+};
+
+/**
+ * @brief Resets a parser and its counters.
+ *
+ * @param parser parser to reset.
+ */
+void host_cmd_init(struct host_cmd_parser *parser)
+{
+	uint8_t *bytes = (uint8_t *)parser;
+	uint8_t i;
+
+	for ( i = 0; i < sizeof(*parser); i++ )
+	{
+		bytes[i] = 0;
+	}
+	parser->state = HOST_CMD_WAIT_SYNC;
+}
+
+/**
+ * @brief Feeds one received byte into the parser.
+ *
+ * Bytes outside of a frame are skipped until the next ::FRAME_SYNC. A frame
+ * that is too long or has a wrong CRC is counted and dropped; the parser
+ * then looks for the next sync byte.
+ *
+ * @param parser parser to use.
+ * @param data received byte.
+ *
+ * @return 1 if \b data completed a valid frame, 0 otherwise. The frame stays
+ *         in the parser until the next byte is fed.
+ */
+uint8_t host_cmd_feed(struct host_cmd_parser *parser, uint8_t data)
+{
+	switch ( parser->state )
+	{
+		case HOST_CMD_WAIT_SYNC:
+			if ( data == FRAME_SYNC )
+			{
+				parser->crc = 0xFFFF;
+				parser->state = HOST_CMD_TYPE;
+			}
+			break;
+
+		case HOST_CMD_TYPE:
+			parser->type = data;
+			parser->crc = crc16_update( parser->crc , data );
+			parser->state = HOST_CMD_LENGTH;
+			break;
+
+		case HOST_CMD_LENGTH:
+			if ( data > FRAME_MAX_PAYLOAD )
+			{
+				parser->length_errors++;
+				parser->state = HOST_CMD_WAIT_SYNC;
+				break;
+			}
+			parser->length = data;
+			parser->crc = crc16_update( parser->crc , data );
+			parser->state = HOST_CMD_SEQUENCE;
+			break;
+
+		case HOST_CMD_SEQUENCE:
+			parser->sequence = data;
+			parser->crc = crc16_update( parser->crc , data );
+			parser->index = 0;
+			parser->state = parser->length ? HOST_CMD_PAYLOAD : HOST_CMD_CRC_HIGH;
+			break;
+
+		case HOST_CMD_PAYLOAD:
+			parser->payload[ parser->index++ ] = data;
+			parser->crc = crc16_update( parser->crc , data );
+			if ( parser->index == parser->length )
+			{
+				parser->state = HOST_CMD_CRC_HIGH;
+			}
+			break;
+
+		case HOST_CMD_CRC_HIGH:
+			parser->crc_high = data;
+			parser->state = HOST_CMD_CRC_LOW;
+			break;
+
+		case HOST_CMD_CRC_LOW:
+			parser->state = HOST_CMD_WAIT_SYNC;
+			if ( parser->crc != ( ( (uint16_t)parser->crc_high << 8 ) | data ) )
+			{
+				parser->crc_errors++;
+				break;
+			}
+			/* Terminate the payload, text handlers can use it as string. */
+			parser->payload[ parser->length ] = 0;
+			parser->frames++;
+			return 1;
+
+		default:
+			parser->state = HOST_CMD_WAIT_SYNC;
+			break;
+	}
+	return 0;
+}
+
+/**
+ * @brief Calls the handler for the frame that was just completed.
+ *
+ * @param parser parser for which host_cmd_feed() returned 1.
+ * @param handlers table of handlers, one per frame type.
+ * @param count number of entries in \b handlers.
+ */
+void host_cmd_dispatch(struct host_cmd_parser *parser,
+		const struct host_cmd_handler *handlers, uint8_t count)
+{
+	uint8_t i;
+
+	for ( i = 0; i < count; i++ )
+	{
+		if ( handlers[i].type == parser->type )
+		{
+			handlers[i].handle( parser->payload , parser->length );
+			return;
+		}
+	}
+	parser->unknown_types++;
+}
+
+/**
+ * @brief Parses received bytes and dispatches complete frames.
+ *
+ * Takes at most \b budget bytes out of the UART receive buffer and returns
+ * when there are no more bytes, so it never blocks. Meant to be called once
+ * per main loop pass.
+ *
+ * @param parser parser to use.
+ * @param handlers table of handlers, one per frame type.
+ * @param count number of entries in \b handlers.
+ * @param budget most bytes handled in this call, see ::HOST_CMD_BUDGET.
+ *
+ * @see uart_rx_read
+ */
+void host_cmd_poll(struct host_cmd_parser *parser,
+		const struct host_cmd_handler *handlers, uint8_t count, uint8_t budget)
+{
+	uint8_t data;
+
+	while ( budget-- && uart_rx_read( &data ) )
+	{
+		if ( host_cmd_feed( parser , data ) )
+		{
+			host_cmd_dispatch( parser , handlers , count );
+		}
+	}
+}
+
+#endif /* HOST_CMD_H_INCLUDED */
@@ -0,0 +1,678 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h>
+
+/** @file
+ * @brief Writes to the LCD without waiting for the display.
+ *
+ * All text goes into ::lcd_shadow, a RAM copy of the 80 characters of the
+ * display. Writing there only takes as long as copying the string. The timer
+ * 1 compare A interrupt then sends the copy to the display in the background,
+ * one nibble per interrupt, with the same timing as the macros in display.h.
+ *
+ * A second copy, ::lcd_panel, holds what the display actually shows. Only
+ * the cells that differ are sent, and an address command is only sent when
+ * the address counter of the display is not already at the cell. Changing
+ * one digit costs two bytes on the bus instead of a whole line.
+ *
+ * Example:
+ * \code
+ * LCD_INIT;
+ * lcd_async_init();
+ * sei();
+ *
+ * lcd_async_write_line( 1 , "Present card" );
+ * lcd_async_write( 3 , 0 , "PIN:" );
+ * // Returns at once, the display is updated while the main loop runs on.
+ * \endcode
+ *
+ * lcd_async_power_on() can be called instead of ::LCD_INIT and
+ * lcd_async_init(). It runs the initialisation sequence of the display in
+ * the background as well, so the about 26 ms of ::LCD_INIT are not spent
+ * waiting. Text written before lcd_async_ready() returns 1 is sent once the
+ * display is ready.
+ *
+ * @pre include/display.h must be included before this file. The display must
+ *      be initialized with ::LCD_INIT before lcd_async_init() is called.
+ *
+ * @warning Timer 1 runs in normal mode once lcd_async_init() was called. The
+ *          macros and funktions of display.h must not be used any more
+ *          afterwards, they would set timer 1 up for their own use.
+ */
+
+#ifndef LCD_ASYNC_H_INCLUDED
+#define LCD_ASYNC_H_INCLUDED
+
+/**
+ * @brief Value of ::lcd_async_cursor when the address counter is not known.
+ */
+#define LCD_ASYNC_CURSOR_UNKNOWN 0xFF
+
+/**
+ * @brief Extra wait after the clear and return home commands, in timer 1
+ *        counts.
+ *
+ * These two commands take 1.52 ms on the ST7066, the normal low phase of the
+ * enable clock only covers the 37 us of the other commands. 1.6 ms are used.
+ */
+#define LCD_ASYNC_LONG_WAIT ( F_CPU / LCD_CLOCKDIVISION / 625 )
+
+#if LCD_ASYNC_LONG_WAIT > 0xFFFF - LCD_TOP_DIV
+#error "LCD_ASYNC_LONG_WAIT does not fit timer 1, use a bigger LCD_CLOCKDIVISION"
+#endif
+
+/**
+ * @brief Timer 1 counts for a time in milliseconds.
+ *
+ * @param MS time in milliseconds.
+ */
+#define LCD_ASYNC_MS( MS ) ( F_CPU / 1000 * (MS) / LCD_CLOCKDIVISION )
+
+/**
+ * @brief Wait after power on before the first byte, in timer 1 counts.
+ *
+ * The same 15 ms ::LCD_INIT waits.
+ */
+#define LCD_ASYNC_POWER_ON_WAIT LCD_ASYNC_MS( 15 )
+
+#if LCD_ASYNC_POWER_ON_WAIT > 0xFFFF
+#error "LCD_ASYNC_POWER_ON_WAIT does not fit timer 1, use a bigger LCD_CLOCKDIVISION"
+#endif
+
+/**
+ * @brief One step of the initialisation sequence.
+ */
+struct lcd_async_step
+{
+	uint8_t byte;   /**< command byte */
+	uint8_t nibble; /**< 1 if only the high nibble is sent */
+	uint16_t wait;  /**< extra wait afterwards, in timer 1 counts */
+};
+
+/**
+ * @brief Initialisation sequence of the display, in flash.
+ *
+ * The same commands and waits as ::LCD_INIT.
+ */
+static const struct lcd_async_step lcd_async_init_steps[] PROGMEM = {
+	{ 0x30 , 1 , LCD_ASYNC_MS( 5 ) },
+	{ 0x30 , 1 , LCD_ASYNC_MS( 1 ) },
+	{ 0x30 , 1 , LCD_ASYNC_MS( 1 ) },
+	{ 0x20 , 1 , LCD_ASYNC_MS( 1 ) },
+	{ 0x28 , 0 , LCD_ASYNC_MS( 1 ) }, /* function set */
+	{ 0x08 , 0 , LCD_ASYNC_MS( 1 ) }, /* display off */
+	{ 0x01 , 0 , LCD_ASYNC_MS( 2 ) }, /* display clear */
+	{ 0x06 , 0 , 0 },                 /* entry mode set */
+	{ 0x0C , 0 , 0 }                  /* display on */
+};
+
+/**
+ * @brief Number of entries in ::lcd_async_init_steps.
+ */
+#define LCD_ASYNC_INIT_STEPS ( sizeof( lcd_async_init_steps ) / sizeof( lcd_async_init_steps[0] ) )
+
+/**
+ * @brief Index into ::lcd_shadow for a line and a column.
+ *
+ * The cells are kept in DDRAM order, so the lines follow each other in the
+ * order 1, 3, 2, 4. Invalid line numbers give line 1, like
+ * ::LCD_JUMP_LINE_START( LINE_NUMBER ) does.
+ *
+ * @param LINE line number from 1 to 4.
+ * @param COLUMN column from 0 to ::LCD_MAX_CHARS_LINE - 1.
+ */
+#define LCD_SHADOW_INDEX( LINE , COLUMN ) ( \
+	( (LINE) == 2 ? 2 * LCD_MAX_CHARS_LINE \
+	: (LINE) == 3 ? LCD_MAX_CHARS_LINE \
+	: (LINE) == 4 ? 3 * LCD_MAX_CHARS_LINE : 0 ) + (COLUMN) )
+
+/**
+ * @brief RAM copy of the characters on the display, in DDRAM order.
+ *
+ * @see LCD_SHADOW_INDEX
+ */
+char lcd_shadow[ LCD_MAX_CHARS ];
+
+/**
+ * @brief Characters the display shows, in DDRAM order.
+ *
+ * Only changed by the interrupt.
+ */
+static char lcd_panel[ LCD_MAX_CHARS ];
+
+/**
+ * @brief Bytes sent to the display since lcd_async_init(), commands included.
+ *
+ * Can be used to compare the bus traffic of screen updates. Read it only
+ * while lcd_async_busy() returns 0, the interrupt changes it.
+ */
+volatile uint16_t lcd_async_transfers = 0;
+
+/**
+ * @brief Set when ::lcd_shadow changed since the current pass started.
+ */
+static volatile uint8_t lcd_async_dirty = 0;
+
+/**
+ * @brief Command waiting to be sent before the next cell, 0 if none.
+ *
+ * @see lcd_async_send_command
+ */
+static volatile uint8_t lcd_async_command = 0;
+
+/**
+ * @brief Extra wait after the byte being sent, in timer 1 counts.
+ */
+static uint16_t lcd_async_wait = 0;
+
+/**
+ * @brief 1 if only the high nibble of ::lcd_async_byte is sent.
+ */
+static uint8_t lcd_async_nibble = 0;
+
+/**
+ * @brief Next step of ::lcd_async_init_steps, ::LCD_ASYNC_INIT_STEPS when
+ *        the display is ready.
+ */
+static volatile uint8_t lcd_async_init_step = LCD_ASYNC_INIT_STEPS;
+
+/**
+ * @brief Rows in flash for each CGRAM character.
+ *
+ * @see lcd_async_load_glyph
+ */
+static const uint8_t *lcd_async_cgram_source[8];
+
+/**
+ * @brief One bit per CGRAM character that still has to be uploaded.
+ */
+static volatile uint8_t lcd_async_cgram_dirty = 0;
+
+/**
+ * @brief CGRAM character being uploaded.
+ */
+static uint8_t lcd_async_cgram_slot;
+
+/**
+ * @brief Next row of the upload, 0 if the CGRAM address has to be set first.
+ */
+static uint8_t lcd_async_cgram_row = 0;
+
+/**
+ * @brief Cells left to compare in the current pass, 0 if none runs.
+ */
+static uint8_t lcd_async_left = 0;
+
+/**
+ * @brief Next cell to compare.
+ */
+static uint8_t lcd_async_scan = 0;
+
+/**
+ * @brief Cell the address counter of the display points to.
+ *
+ * In DDRAM order, like ::LCD_SHADOW_INDEX. ::LCD_ASYNC_CURSOR_UNKNOWN
+ * forces an address command before the next character.
+ */
+static uint8_t lcd_async_cursor = LCD_ASYNC_CURSOR_UNKNOWN;
+
+/**
+ * @brief Half of the enable clock the interrupt does next, 0 to 3.
+ */
+static uint8_t lcd_async_phase = 0;
+
+/**
+ * @brief Byte the interrupt is sending.
+ */
+static uint8_t lcd_async_byte;
+
+/**
+ * @brief 1 if ::lcd_async_byte is a character, 0 for a command.
+ */
+static uint8_t lcd_async_char;
+
+/**
+ * @brief Sets up the background transfer.
+ *
+ * Fills ::lcd_shadow and ::lcd_panel with spaces, which is what the display
+ * shows after ::LCD_INIT or ::LCD_CLEAR, and lets timer 1 run free with
+ * ::LCD_CLOCKDIVISION.
+ *
+ * @pre The display must be initialized with ::LCD_INIT.
+ */
+void lcd_async_init(void)
+{
+	uint8_t i;
+
+	for ( i = 0; i < LCD_MAX_CHARS; i++ )
+	{
+		lcd_shadow[i] = ' ';
+		lcd_panel[i] = ' ';
+	}
+	lcd_async_transfers = 0;
+	lcd_async_dirty = 0;
+	lcd_async_command = 0;
+	lcd_async_wait = 0;
+	lcd_async_nibble = 0;
+	lcd_async_init_step = LCD_ASYNC_INIT_STEPS;
+	lcd_async_cgram_dirty = 0;
+	lcd_async_cgram_row = 0;
+	lcd_async_left = 0;
+	lcd_async_scan = 0;
+	lcd_async_cursor = LCD_ASYNC_CURSOR_UNKNOWN;
+	lcd_async_phase = 0;
+
+	LCD_PORT_SETUP;
+	LCD_PORT &= ~_BV( LCD_EN );
+	T1_CTC_INT_OFF;
+	T1_STOP;
+	T1_NORMAL;
+	T1_RESET;
+	T1_START_DIV( LCD_CLOCKDIVISION );
+}
+
+/**
+ * @brief Sets up the background transfer and initializes the display in the
+ *        background.
+ *
+ * Replaces ::LCD_INIT followed by lcd_async_init(). Returns at once, the
+ * interrupt waits ::LCD_ASYNC_POWER_ON_WAIT and then sends the sequence of
+ * ::lcd_async_init_steps. Text can be written right away, it is sent when
+ * the sequence is done.
+ *
+ * @post Interrupts must be enabled for the display to become ready.
+ *
+ * @see lcd_async_ready
+ */
+void lcd_async_power_on(void)
+{
+	lcd_async_init();
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		lcd_async_init_step = 0;
+		OCR1A = TCNT1 + LCD_ASYNC_POWER_ON_WAIT;
+		T1_COMP_MATCH_TOP_CLEAR;
+		T1_CTC_INT_ON;
+	}
+}
+
+/**
+ * @brief Tells if the display is initialized.
+ *
+ * @return 1 once the last command of the sequence started by
+ *         lcd_async_power_on() is being sent, or if lcd_async_init() was
+ *         used; 0 otherwise. Bytes sent afterwards reach the display
+ *         initialized.
+ */
+uint8_t lcd_async_ready(void)
+{
+	return lcd_async_init_step >= LCD_ASYNC_INIT_STEPS;
+}
+
+/**
+ * @brief Tells if the display still has to be updated.
+ *
+ * @return 1 while ::lcd_shadow is not completely on the display, a command
+ *         is waiting or the display is not ready, 0 otherwise.
+ */
+uint8_t lcd_async_busy(void)
+{
+	return lcd_async_dirty || lcd_async_command || lcd_async_cgram_dirty
+		|| !lcd_async_ready() || ( TIMSK & _BV( OCIE1A ) );
+}
+
+/**
+ * @brief Waits until the display shows ::lcd_shadow.
+ *
+ * @pre Interrupts must be enabled.
+ */
+void lcd_async_flush(void)
+{
+	while ( lcd_async_busy() );
+}
+
+/**
+ * @brief Starts the interrupt if it is not running.
+ *
+ * @pre Interrupts must be disabled.
+ */
+static void lcd_async_start(void)
+{
+	if ( !( TIMSK & _BV( OCIE1A ) ) )
+	{
+		/* Two counts ahead, a match on the count that is just being
+		 * written would be missed. */
+		OCR1A = TCNT1 + 2;
+		T1_COMP_MATCH_TOP_CLEAR;
+		T1_CTC_INT_ON;
+	}
+}
+
+/**
+ * @brief Marks ::lcd_shadow as changed and starts a pass if none runs.
+ *
+ * A pass that is already running is followed by another one, so cells that
+ * changed behind it are not missed.
+ */
+void lcd_async_update(void)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		lcd_async_dirty = 1;
+		lcd_async_start();
+	}
+}
+
+/**
+ * @brief Sends a command byte to the display in the background.
+ *
+ * The command goes out before the next changed cell. Display shift commands
+ * leave the address counter alone. After clear (0x01) all cells are sent
+ * again, after return home (0x02) the address counter is known to be 0. Any
+ * other command makes the next character start with an address command.
+ *
+ * Can be called from interrupts.
+ *
+ * @param command command byte, not 0.
+ *
+ * @return 1 if the command was taken, 0 if another one is still waiting.
+ */
+uint8_t lcd_async_send_command(uint8_t command)
+{
+	uint8_t taken = 0;
+
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		if ( !lcd_async_command )
+		{
+			lcd_async_command = command;
+			lcd_async_start();
+			taken = 1;
+		}
+	}
+	return taken;
+}
+
+/**
+ * @brief Uploads a user defined character to CGRAM in the background.
+ *
+ * The eight rows are sent before the next changed cell, so a cell that shows
+ * the character is only updated once the character is complete. Cells that
+ * already show it change at once.
+ *
+ * @param slot CGRAM character, 0 to 7. It is shown by the character codes
+ *             \b slot and \b slot + 8.
+ * @param rows eight rows in flash, the lowest five bits of each are used.
+ */
+void lcd_async_load_glyph(uint8_t slot, const uint8_t *rows)
+{
+	slot &= 0x07;
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		lcd_async_cgram_source[ slot ] = rows;
+		lcd_async_cgram_dirty |= _BV( slot );
+		if ( lcd_async_cgram_row && lcd_async_cgram_slot == slot )
+		{
+			/* Being uploaded, start over with the new rows. */
+			lcd_async_cgram_row = 0;
+		}
+		lcd_async_start();
+	}
+}
+
+/**
+ * @brief Writes a string into a line of the display.
+ *
+ * The string is cut at the end of the line, the rest of the line is not
+ * touched.
+ *
+ * @param line line number from 1 to 4.
+ * @param column column of the first character, from 0.
+ * @param text string that should be shown.
+ */
+void lcd_async_write(uint8_t line, uint8_t column, const char *text)
+{
+	char *cell = &lcd_shadow[ LCD_SHADOW_INDEX( line , 0 ) ];
+
+	for ( ; column < LCD_MAX_CHARS_LINE && *text != 0; column++ )
+	{
+		cell[ column ] = *text++;
+	}
+	lcd_async_update();
+}
+
+/**
+ * @brief Writes a string to a whole line of the display.
+ *
+ * Like lcd_write_line( char *line_text ), the string is cut at
+ * ::LCD_MAX_CHARS_LINE characters and the rest of the line is cleared.
+ *
+ * @param line line number from 1 to 4.
+ * @param text string that should be shown.
+ */
+void lcd_async_write_line(uint8_t line, const char *text)
+{
+	char *cell = &lcd_shadow[ LCD_SHADOW_INDEX( line , 0 ) ];
+	uint8_t column;
+
+	for ( column = 0; column < LCD_MAX_CHARS_LINE; column++ )
+	{
+		cell[ column ] = *text ? *text++ : ' ';
+	}
+	lcd_async_update();
+}
+
+/**
+ * @brief Clears the display.
+ *
+ * Unlike ::LCD_CLEAR no clear command is sent, the cells are overwritten with
+ * spaces. So there is no 2 ms wait.
+ */
+void lcd_async_clear(void)
+{
+	uint8_t i;
+
+	for ( i = 0; i < LCD_MAX_CHARS; i++ )
+	{
+		lcd_shadow[i] = ' ';
+	}
+	lcd_async_update();
+}
+
+/**
+ * @brief Picks the next byte of the current pass.
+ *
+ * Called from the interrupt. The initialisation sequence goes first, then a
+ * waiting command, then waiting CGRAM uploads. A pass compares all 80 cells once, starting at
+ * the cell after the last one sent. Cells that already show the right
+ * character are skipped. Starts a new pass if ::lcd_shadow changed.
+ *
+ * The address counter of the display counts on by itself after every
+ * character, from 0x27 to 0x40 and from 0x67 to 0x00. In DDRAM order this is
+ * just the next cell, so a row of changed cells needs one address command.
+ *
+ * @return 1 if ::lcd_async_byte has to be sent, 0 if the display is up to
+ *         date.
+ */
+static uint8_t lcd_async_load(void)
+{
+	uint8_t cell = lcd_async_scan;
+	uint8_t i;
+
+	lcd_async_wait = 0;
+	lcd_async_nibble = 0;
+	if ( lcd_async_init_step < LCD_ASYNC_INIT_STEPS )
+	{
+		i = lcd_async_init_step++;
+		lcd_async_byte = pgm_read_byte( &lcd_async_init_steps[i].byte );
+		lcd_async_nibble = pgm_read_byte( &lcd_async_init_steps[i].nibble );
+		lcd_async_wait = pgm_read_word( &lcd_async_init_steps[i].wait );
+		lcd_async_char = 0;
+		lcd_async_transfers++;
+		return 1;
+	}
+
+	if ( lcd_async_command )
+	{
+		lcd_async_byte = lcd_async_command;
+		lcd_async_char = 0;
+		lcd_async_command = 0;
+		lcd_async_transfers++;
+
+		if ( lcd_async_byte <= 0x03 )
+		{
+			/* Clear or return home. */
+			lcd_async_wait = LCD_ASYNC_LONG_WAIT;
+			lcd_async_cursor = 0;
+			if ( lcd_async_byte == 0x01 )
+			{
+				for ( i = 0; i < LCD_MAX_CHARS; i++ )
+				{
+					lcd_panel[i] = ' ';
+				}
+				lcd_async_dirty = 1;
+			}
+		}
+		else if ( ( lcd_async_byte & 0xF8 ) != 0x18 )
+		{
+			/* Anything but a display shift may move the cursor. */
+			lcd_async_cursor = LCD_ASYNC_CURSOR_UNKNOWN;
+		}
+		if ( ( lcd_async_byte & 0xF8 ) != 0x18 )
+		{
+			/* The address counter left CGRAM, start the upload over. */
+			lcd_async_cgram_row = 0;
+		}
+		return 1;
+	}
+
+	if ( lcd_async_cgram_dirty )
+	{
+		lcd_async_transfers++;
+		if ( lcd_async_cgram_row == 0 )
+		{
+			/* Set CGRAM address of the first waiting character. */
+			for ( i = 0; !( lcd_async_cgram_dirty & _BV( i ) ); i++ );
+			lcd_async_cgram_slot = i;
+			lcd_async_byte = 0x40 | ( i << 3 );
+			lcd_async_char = 0;
+			lcd_async_cgram_row = 1;
+			/* The address counter now points into CGRAM. */
+			lcd_async_cursor = LCD_ASYNC_CURSOR_UNKNOWN;
+			return 1;
+		}
+		lcd_async_byte = pgm_read_byte( lcd_async_cgram_source[ lcd_async_cgram_slot ]
+						+ lcd_async_cgram_row - 1 );
+		lcd_async_char = 1;
+		if ( ++lcd_async_cgram_row > 8 )
+		{
+			lcd_async_cgram_row = 0;
+			lcd_async_cgram_dirty &= ~_BV( lcd_async_cgram_slot );
+		}
+		return 1;
+	}
+
+	while ( 1 )
+	{
+		if ( lcd_async_left == 0 )
+		{
+			if ( !lcd_async_dirty )
+			{
+				lcd_async_scan = cell;
+				return 0;
+			}
+			lcd_async_dirty = 0;
+			lcd_async_left = LCD_MAX_CHARS;
+		}
+		if ( lcd_shadow[ cell ] != lcd_panel[ cell ] )
+		{
+			break;
+		}
+		if ( ++cell == LCD_MAX_CHARS )
+		{
+			cell = 0;
+		}
+		lcd_async_left--;
+	}
+	lcd_async_transfers++;
+
+	if ( cell != lcd_async_cursor )
+	{
+		/* Set DDRAM address first, the cell is sent next time. */
+		lcd_async_byte = 0x80 | ( cell < LCD_MAX_CHARS / 2
+					? cell : cell - LCD_MAX_CHARS / 2 + 0x40 );
+		lcd_async_char = 0;
+		lcd_async_cursor = cell;
+		lcd_async_scan = cell;
+		return 1;
+	}
+
+	lcd_async_byte = lcd_shadow[ cell ];
+	lcd_panel[ cell ] = lcd_async_byte;
+	lcd_async_char = 1;
+	if ( ++cell == LCD_MAX_CHARS )
+	{
+		cell = 0;
+	}
+	lcd_async_cursor = cell;
+	lcd_async_scan = cell;
+	lcd_async_left--;
+	return 1;
+}
+
+/**
+ * @brief interrupt service routine for the background transfer
+ *
+ * Every call does one half of the enable clock of a nibble: the high phase
+ * lasts ::LCD_EXTRA_DIV counts, the low phase the rest of ::LCD_TOP_DIV, just
+ * like ::LCD_WAIT_CLK_HIGH and ::LCD_WAIT_CLK_LOW. A single nibble of the
+ * initialisation sequence ends after phase 1. The interrupt switches itself
+ * off when the display is up to date.
+ */
+ISR(TIMER1_COMPA_vect)
+{
+	switch ( lcd_async_phase )
+	{
+		case 0:
+			if ( !lcd_async_load() )
+			{
+				T1_CTC_INT_OFF;
+				return;
+			}
+			if ( lcd_async_char )
+			{
+				LCD_CHAR_MODE;
+			}
+			else
+			{
+				LCD_CMD_MODE;
+			}
+			LCD_DATA_SETUP_HIGH_NIBBLE( lcd_async_byte );
+			LCD_PORT |= _BV( LCD_EN );
+			OCR1A += LCD_EXTRA_DIV;
+			break;
+
+		case 2:
+			LCD_DATA_SETUP_LOW_NIBBLE( lcd_async_byte );
+			LCD_PORT |= _BV( LCD_EN );
+			OCR1A += LCD_EXTRA_DIV;
+			break;
+
+		default:
+			/* Phases 1 and 3, low half of the clock. */
+			LCD_PORT &= ~_BV( LCD_EN );
+			OCR1A += LCD_TOP_DIV - LCD_EXTRA_DIV;
+			if ( lcd_async_phase == 3 || lcd_async_nibble )
+			{
+				/* Last nibble of the byte. */
+				OCR1A += lcd_async_wait;
+				lcd_async_phase = 3;
+			}
+			break;
+	}
+	lcd_async_phase = ( lcd_async_phase + 1 ) & 0x03;
+}
+
+#endif /* LCD_ASYNC_H_INCLUDED */
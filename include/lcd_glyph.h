@@ -0,0 +1,330 @@
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+/** @file
+ * @brief Shows characters the display ROM does not have, e.g. æ, ø and å.
+ *
+ * The ST7066 has eight user defined characters in CGRAM. This file keeps a
+ * cache of which glyph is in which of these slots. Text is given as UTF-8;
+ * bytes that are not valid UTF-8 are taken as Latin-1, so both encodings the
+ * HACS server may send work. Overlong UTF-8 sequences, e.g. C0 80, are no
+ * valid text in either encoding and are shown as ::LCD_GLYPH_FALLBACK.
+ *
+ * ASCII characters go to the display as they are. Other characters are looked
+ * up in ::lcd_glyphs. A glyph that is already in a slot costs nothing extra
+ * on the bus. Otherwise it is uploaded to a free slot, or to the slot that was
+ * used least recently among those not on the display. If all eight slots are
+ * on the display, or the character has no glyph, ::LCD_GLYPH_FALLBACK is
+ * shown.
+ *
+ * The slots are shown with the character codes 8 to 15, which show the same
+ * CGRAM characters as 0 to 7 but do not end a string.
+ *
+ * @pre lcd_async.h must be included before this file and lcd_async_init()
+ *      must have been called.
+ */
+
+#ifndef LCD_GLYPH_H_INCLUDED
+#define LCD_GLYPH_H_INCLUDED
+
+/**
+ * @brief Number of CGRAM slots of the ST7066.
+ */
+#define LCD_GLYPH_SLOTS 8
+
+/**
+ * @brief Character code of the first slot.
+ */
+#define LCD_GLYPH_FIRST_CODE 8
+
+/**
+ * @brief Value of ::lcd_glyph_slots for an empty slot.
+ */
+#define LCD_GLYPH_EMPTY 0xFF
+
+#ifndef LCD_GLYPH_FALLBACK
+/**
+ * @brief Shown for characters that can not be shown.
+ *
+ * Can be overridden by defining it before this file is included.
+ */
+#define LCD_GLYPH_FALLBACK '?'
+#endif
+
+/**
+ * @brief Code point returned by lcd_glyph_decode() for an overlong sequence.
+ *
+ * The Unicode replacement character, it has no glyph and is shown as
+ * ::LCD_GLYPH_FALLBACK.
+ */
+#define LCD_GLYPH_INVALID 0xFFFD
+
+/**
+ * @brief A character and its 5x8 bitmap.
+ */
+struct lcd_glyph
+{
+	uint16_t code;   /**< Unicode code point */
+	uint8_t rows[8]; /**< rows from top to bottom, lowest five bits used */
+};
+
+/**
+ * @brief Glyphs that can be shown, in flash.
+ *
+ * New characters can be added here, the cache does not depend on the
+ * number of entries.
+ */
+const struct lcd_glyph lcd_glyphs[] PROGMEM = {
+	{ 0x00C5 , { 0x04 , 0x0A , 0x04 , 0x0E , 0x11 , 0x1F , 0x11 , 0x00 } }, /* Å */
+	{ 0x00C6 , { 0x0F , 0x14 , 0x14 , 0x1F , 0x14 , 0x14 , 0x17 , 0x00 } }, /* Æ */
+	{ 0x00D8 , { 0x0E , 0x13 , 0x13 , 0x15 , 0x19 , 0x19 , 0x0E , 0x00 } }, /* Ø */
+	{ 0x00E5 , { 0x04 , 0x0A , 0x04 , 0x0E , 0x01 , 0x0F , 0x11 , 0x0F } }, /* å */
+	{ 0x00E6 , { 0x00 , 0x00 , 0x1A , 0x05 , 0x0F , 0x14 , 0x0B , 0x00 } }, /* æ */
+	{ 0x00F8 , { 0x00 , 0x00 , 0x0E , 0x13 , 0x15 , 0x19 , 0x0E , 0x00 } }  /* ø */
+};
+
+/**
+ * @brief Number of entries in ::lcd_glyphs.
+ */
+#define LCD_GLYPH_COUNT ( sizeof( lcd_glyphs ) / sizeof( lcd_glyphs[0] ) )
+
+/**
+ * @brief Counters of the glyph cache.
+ */
+struct lcd_glyph_stats
+{
+	uint16_t hits;      /**< glyphs that were already in a slot */
+	uint16_t uploads;   /**< glyphs uploaded to a slot, 9 bytes on the bus each */
+	uint16_t fallbacks; /**< characters shown as ::LCD_GLYPH_FALLBACK */
+};
+
+/**
+ * @brief Counters of the glyph cache, reset by lcd_glyph_init().
+ */
+struct lcd_glyph_stats lcd_glyph_counters;
+
+/**
+ * @brief Index into ::lcd_glyphs of the glyph in each slot.
+ */
+static uint8_t lcd_glyph_slots[ LCD_GLYPH_SLOTS ];
+
+/**
+ * @brief Value of ::lcd_glyph_clock when each slot was last used.
+ */
+static uint8_t lcd_glyph_used[ LCD_GLYPH_SLOTS ];
+
+/**
+ * @brief Counts up with every glyph that is shown, for the LRU order.
+ */
+static uint8_t lcd_glyph_clock = 0;
+
+/**
+ * @brief Empties the cache and resets the counters.
+ */
+void lcd_glyph_init(void)
+{
+	uint8_t slot;
+
+	for ( slot = 0; slot < LCD_GLYPH_SLOTS; slot++ )
+	{
+		lcd_glyph_slots[ slot ] = LCD_GLYPH_EMPTY;
+		lcd_glyph_used[ slot ] = 0;
+	}
+	lcd_glyph_clock = 0;
+	lcd_glyph_counters.hits = 0;
+	lcd_glyph_counters.uploads = 0;
+	lcd_glyph_counters.fallbacks = 0;
+}
+
+/**
+ * @brief Tells if a slot is shown or about to be shown on the display.
+ *
+ * @param slot slot number, 0 to 7.
+ *
+ * @return 1 if a cell of ::lcd_shadow or ::lcd_panel uses the slot.
+ */
+static uint8_t lcd_glyph_on_screen(uint8_t slot)
+{
+	uint8_t i;
+
+	for ( i = 0; i < LCD_MAX_CHARS; i++ )
+	{
+		if ( lcd_shadow[i] == LCD_GLYPH_FIRST_CODE + slot
+		  || lcd_panel[i] == LCD_GLYPH_FIRST_CODE + slot )
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Display character for a Unicode code point.
+ *
+ * Uploads the glyph if it is not in a slot yet.
+ *
+ * @param code Unicode code point.
+ *
+ * @return character code to write into ::lcd_shadow.
+ */
+char lcd_glyph_char(uint16_t code)
+{
+	uint8_t glyph;
+	uint8_t slot;
+	uint8_t victim = LCD_GLYPH_EMPTY;
+	uint8_t age = 0;
+
+	if ( code >= 0x20 && code < 0x7F )
+	{
+		return (char)code;
+	}
+
+	for ( glyph = 0; glyph < LCD_GLYPH_COUNT; glyph++ )
+	{
+		if ( pgm_read_word( &lcd_glyphs[ glyph ].code ) == code )
+		{
+			break;
+		}
+	}
+	if ( glyph == LCD_GLYPH_COUNT )
+	{
+		lcd_glyph_counters.fallbacks++;
+		return LCD_GLYPH_FALLBACK;
+	}
+
+	lcd_glyph_clock++;
+	for ( slot = 0; slot < LCD_GLYPH_SLOTS; slot++ )
+	{
+		if ( lcd_glyph_slots[ slot ] == glyph )
+		{
+			lcd_glyph_used[ slot ] = lcd_glyph_clock;
+			lcd_glyph_counters.hits++;
+			return LCD_GLYPH_FIRST_CODE + slot;
+		}
+	}
+
+	/* Miss: take an empty slot, or the oldest one not on the display. */
+	for ( slot = 0; slot < LCD_GLYPH_SLOTS; slot++ )
+	{
+		if ( lcd_glyph_slots[ slot ] == LCD_GLYPH_EMPTY )
+		{
+			victim = slot;
+			break;
+		}
+		if ( (uint8_t)( lcd_glyph_clock - lcd_glyph_used[ slot ] ) >= age
+		  && !lcd_glyph_on_screen( slot ) )
+		{
+			age = lcd_glyph_clock - lcd_glyph_used[ slot ];
+			victim = slot;
+		}
+	}
+	if ( victim == LCD_GLYPH_EMPTY )
+	{
+		lcd_glyph_counters.fallbacks++;
+		return LCD_GLYPH_FALLBACK;
+	}
+
+	lcd_glyph_slots[ victim ] = glyph;
+	lcd_glyph_used[ victim ] = lcd_glyph_clock;
+	lcd_async_load_glyph( victim , lcd_glyphs[ glyph ].rows );
+	lcd_glyph_counters.uploads++;
+	return LCD_GLYPH_FIRST_CODE + victim;
+}
+
+/**
+ * @brief Reads one character from a UTF-8 string.
+ *
+ * A byte that does not start a valid two or three byte sequence is taken as
+ * a Latin-1 character. A sequence that encodes a code point with more bytes
+ * than needed, e.g. C0 80 or E0 80 80, is skipped as a whole and read as
+ * ::LCD_GLYPH_INVALID.
+ *
+ * @param text pointer to the string, moved behind the character.
+ *
+ * @return Unicode code point, 0 at the end of the string.
+ */
+uint16_t lcd_glyph_decode(const char **text)
+{
+	const uint8_t *s = (const uint8_t *)*text;
+	uint16_t code = s[0];
+
+	if ( code == 0 )
+	{
+		return 0;
+	}
+	if ( ( s[0] & 0xE0 ) == 0xC0 && ( s[1] & 0xC0 ) == 0x80 )
+	{
+		code = ( ( s[0] & 0x1F ) << 6 ) | ( s[1] & 0x3F );
+		*text += 2;
+		/* Lead bytes C0 and C1 are overlong. */
+		return code < 0x80 ? LCD_GLYPH_INVALID : code;
+	}
+	if ( ( s[0] & 0xF0 ) == 0xE0 && ( s[1] & 0xC0 ) == 0x80 && ( s[2] & 0xC0 ) == 0x80 )
+	{
+		code = ( (uint16_t)( s[0] & 0x0F ) << 12 ) | ( ( s[1] & 0x3F ) << 6 ) | ( s[2] & 0x3F );
+		*text += 3;
+		return code < 0x800 ? LCD_GLYPH_INVALID : code;
+	}
+	*text += 1;
+	return code;
+}
+
+/**
+ * @brief Writes a UTF-8 string into a line of the display.
+ *
+ * Like lcd_async_write( uint8_t line , uint8_t column , const char *text ),
+ * but characters outside of ASCII are shown through the glyph cache.
+ *
+ * @param line line number from 1 to 4.
+ * @param column column of the first character, from 0.
+ * @param text UTF-8 or Latin-1 string.
+ */
+void lcd_glyph_write(uint8_t line, uint8_t column, const char *text)
+{
+	char *cell = &lcd_shadow[ LCD_SHADOW_INDEX( line , 0 ) ];
+	uint16_t code;
+
+	for ( ; column < LCD_MAX_CHARS_LINE; column++ )
+	{
+		code = lcd_glyph_decode( &text );
+		if ( code == 0 )
+		{
+			break;
+		}
+		cell[ column ] = lcd_glyph_char( code );
+	}
+	lcd_async_update();
+}
+
+/**
+ * @brief Writes a UTF-8 string to a whole line of the display.
+ *
+ * Like lcd_async_write_line( uint8_t line , const char *text ), but
+ * characters outside of ASCII are shown through the glyph cache.
+ *
+ * @param line line number from 1 to 4.
+ * @param text UTF-8 or Latin-1 string.
+ */
+void lcd_glyph_write_line(uint8_t line, const char *text)
+{
+	char *cell = &lcd_shadow[ LCD_SHADOW_INDEX( line , 0 ) ];
+	uint8_t column;
+	uint16_t code;
+
+	for ( column = 0; column < LCD_MAX_CHARS_LINE; column++ )
+	{
+		code = lcd_glyph_decode( &text );
+		if ( code == 0 )
+		{
+			break;
+		}
+		cell[ column ] = lcd_glyph_char( code );
+	}
+	for ( ; column < LCD_MAX_CHARS_LINE; column++ )
+	{
+		cell[ column ] = ' ';
+	}
+	lcd_async_update();
+}
+
+#endif /* LCD_GLYPH_H_INCLUDED */
@@ -0,0 +1,189 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+
+/** @file
+ * @brief Scrolls messages longer than a line with the display shift command.
+ *
+ * The ST7066 has 40 cells per DDRAM row. On the 20x4 display, row 0 holds
+ * line 1 (cells 0 to 19) and line 3 (cells 20 to 39), row 1 holds line 2 and
+ * line 4. The display shift command moves the visible window over both rows
+ * by one cell, without touching DDRAM.
+ *
+ * lcd_marquee_start() writes a message of up to 40 characters once into the
+ * row of the given line. Timer 1 compare B then sends one shift command per
+ * step, so each step costs one byte on the bus instead of twenty characters.
+ * The message runs through its line and comes back around:
+ *
+ * <ul>
+ * 	<li>After \b k steps, line 1 shows cells \b k to \b k + 19 of row 0 and
+ * 	    line 3 shows cells \b k + 20 to \b k + 39, counted modulo 40. The same
+ * 	    holds for lines 2 and 4 in row 1.</li>
+ * 	<li>A message started on line 3 begins at cell 20 of row 0, so it scrolls
+ * 	    into line 3 the same way a message on line 1 does.</li>
+ * </ul>
+ *
+ * Example:
+ * \code
+ * lcd_async_write_line( 3 , "" );
+ * lcd_marquee_start( 1 , "Room 12: heating on, lights dimmed to 40%" );
+ * ...
+ * lcd_marquee_stop();
+ * \endcode
+ *
+ * @pre lcd_async.h must be included before this file and lcd_async_init()
+ *      must have been called.
+ *
+ * @warning The shift moves all four lines. While a marquee runs, the other
+ *          line of the same row shows the rest of the message, and the other
+ *          row scrolls along. Text written with lcd_async_write() keeps its
+ *          DDRAM cell and moves with the window. lcd_marquee_stop() puts the
+ *          window back.
+ */
+
+#ifndef LCD_MARQUEE_H_INCLUDED
+#define LCD_MARQUEE_H_INCLUDED
+
+/**
+ * @brief Cells in one DDRAM row, the longest message.
+ */
+#define LCD_MARQUEE_CELLS ( LCD_MAX_CHARS / 2 )
+
+/**
+ * @brief Timer 1 counts per marquee tick of 10 ms.
+ */
+#define LCD_MARQUEE_TICK ( F_CPU / LCD_CLOCKDIVISION / 100 )
+
+#if LCD_MARQUEE_TICK > 0xFFFF
+#error "10 ms marquee tick does not fit timer 1, use a bigger LCD_CLOCKDIVISION"
+#endif
+
+#ifndef LCD_MARQUEE_INTERVAL
+/**
+ * @brief Default time between two steps, in ticks of 10 ms.
+ *
+ * 1 to 255, 1 is the fastest. Can be overridden by defining it before this
+ * file is included, or at run time with ::lcd_marquee_interval.
+ */
+#define LCD_MARQUEE_INTERVAL 30
+#endif
+
+#if LCD_MARQUEE_INTERVAL < 1 || LCD_MARQUEE_INTERVAL > 255
+#error "LCD_MARQUEE_INTERVAL must be 1 to 255 ticks of 10 ms"
+#endif
+
+/**
+ * @brief Command byte that shifts the display one cell to the left.
+ */
+#define LCD_CMD_SHIFT_LEFT 0x18
+
+/**
+ * @brief Command byte that resets the display shift and the cursor.
+ */
+#define LCD_CMD_RETURN_HOME 0x02
+
+/**
+ * @brief Time between two steps in ticks of 10 ms.
+ *
+ * 1 steps every 10 ms, the fastest. 0 holds the window where it is until
+ * another value is set, lcd_marquee_stop() is needed to put it back.
+ */
+volatile uint8_t lcd_marquee_interval = LCD_MARQUEE_INTERVAL;
+
+/**
+ * @brief Steps the window is shifted to the left, 0 to 39.
+ */
+volatile uint8_t lcd_marquee_offset = 0;
+
+/**
+ * @brief Ticks left until the next step.
+ */
+static volatile uint8_t lcd_marquee_countdown;
+
+/**
+ * @brief Starts scrolling a message.
+ *
+ * The message is written into the 40 cells of the row of \b line, starting
+ * at the first cell of \b line and going around the end of the row. Unused
+ * cells are filled with spaces, so there is a gap before the message starts
+ * over. Longer messages are cut at 40 characters.
+ *
+ * A marquee that already runs goes on with the new text.
+ *
+ * @param line line number from 1 to 4.
+ * @param text message to show.
+ */
+void lcd_marquee_start(uint8_t line, const char *text)
+{
+	uint8_t row = LCD_SHADOW_INDEX( line , 0 ) >= LCD_MARQUEE_CELLS ? LCD_MARQUEE_CELLS : 0;
+	uint8_t cell = LCD_SHADOW_INDEX( line , 0 ) - row;
+	uint8_t i;
+
+	for ( i = 0; i < LCD_MARQUEE_CELLS; i++ )
+	{
+		lcd_shadow[ row + cell ] = *text ? *text++ : ' ';
+		if ( ++cell == LCD_MARQUEE_CELLS )
+		{
+			cell = 0;
+		}
+	}
+	lcd_async_update();
+
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		if ( !( TIMSK & _BV( OCIE1B ) ) )
+		{
+			lcd_marquee_countdown = lcd_marquee_interval;
+			OCR1B = TCNT1 + LCD_MARQUEE_TICK;
+			TIFR = _BV( OCF1B );
+			TIMSK |= _BV( OCIE1B );
+		}
+	}
+}
+
+/**
+ * @brief Stops scrolling and puts the window back to its start.
+ *
+ * The return home command is queued behind a shift that may still wait, so
+ * this can wait for up to one byte on the bus.
+ */
+void lcd_marquee_stop(void)
+{
+	TIMSK &= ~_BV( OCIE1B );
+	while ( !lcd_async_send_command( LCD_CMD_RETURN_HOME ) );
+	lcd_marquee_offset = 0;
+}
+
+/**
+ * @brief interrupt service routine for the marquee steps
+ *
+ * Runs every 10 ms while a marquee is active and queues one shift command
+ * every ::lcd_marquee_interval ticks, none while it is 0. If the previous
+ * command has not gone out yet, the step is tried again in the next tick.
+ */
+ISR(TIMER1_COMPB_vect)
+{
+	OCR1B += LCD_MARQUEE_TICK;
+	if ( !lcd_marquee_interval )
+	{
+		/* Paused, step in the first tick after an interval is set. */
+		lcd_marquee_countdown = 1;
+		return;
+	}
+	if ( --lcd_marquee_countdown )
+	{
+		return;
+	}
+	if ( !lcd_async_send_command( LCD_CMD_SHIFT_LEFT ) )
+	{
+		lcd_marquee_countdown = 1;
+		return;
+	}
+	lcd_marquee_countdown = lcd_marquee_interval;
+	if ( ++lcd_marquee_offset == LCD_MARQUEE_CELLS )
+	{
+		lcd_marquee_offset = 0;
+	}
+}
+
+#endif /* LCD_MARQUEE_H_INCLUDED */
@@ -0,0 +1,112 @@
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+/** @file
+ * @brief Screen layouts in flash with fields that are filled in at run time.
+ *
+ * A screen is declared with ::LCD_SCREEN from its four lines as they are
+ * seen on the display. The compiler joins them into an image of the 80 DDRAM
+ * cells in flash, already in the order 1, 3, 2, 4 of the DDRAM addresses. No
+ * RAM is used for the text.
+ *
+ * lcd_screen_show() copies the image into ::lcd_shadow in one pass, and
+ * lcd_screen_field() fills a named field. The display is then updated in the
+ * background by lcd_async.h. Since the cells are in DDRAM order, a full
+ * screen goes out as one address command and 80 characters. Only cells that
+ * differ from the display are sent, so switching between screens that share
+ * text costs less.
+ *
+ * Example:
+ * \code
+ * LCD_SCREEN( screen_pin ,
+ * 	"Welcome             " ,
+ * 	"                    " ,
+ * 	"Enter PIN: ____     " ,
+ * 	"                    " );
+ *
+ * #define FIELD_NAME LCD_FIELD( 1 , 8 , 12 )
+ * #define FIELD_PIN  LCD_FIELD( 3 , 11 , 4 )
+ *
+ * lcd_screen_show( screen_pin );
+ * lcd_screen_field( FIELD_NAME , name );
+ * ...
+ * lcd_screen_field( FIELD_PIN , "**__" );
+ * \endcode
+ *
+ * @pre lcd_async.h must be included before this file and lcd_async_init()
+ *      or lcd_async_power_on() must have been called.
+ */
+
+#ifndef LCD_SCREEN_H_INCLUDED
+#define LCD_SCREEN_H_INCLUDED
+
+/**
+ * @brief Declares a screen in flash.
+ *
+ * Every line must be a string literal of exactly ::LCD_MAX_CHARS_LINE
+ * characters, otherwise the build fails.
+ *
+ * @param NAME name of the screen, used with lcd_screen_show().
+ * @param LINE1 text of line 1.
+ * @param LINE2 text of line 2.
+ * @param LINE3 text of line 3.
+ * @param LINE4 text of line 4.
+ */
+#define LCD_SCREEN( NAME , LINE1 , LINE2 , LINE3 , LINE4 ) \
+	typedef char NAME##_lines_must_have_20_characters[ \
+		( sizeof( LINE1 ) == LCD_MAX_CHARS_LINE + 1 \
+		&& sizeof( LINE2 ) == LCD_MAX_CHARS_LINE + 1 \
+		&& sizeof( LINE3 ) == LCD_MAX_CHARS_LINE + 1 \
+		&& sizeof( LINE4 ) == LCD_MAX_CHARS_LINE + 1 ) ? 1 : -1 ]; \
+	const char NAME[ LCD_MAX_CHARS ] PROGMEM = LINE1 LINE3 LINE2 LINE4
+
+/**
+ * @brief Describes a field of a screen, for lcd_screen_field().
+ *
+ * Expands to the index into ::lcd_shadow and the width, both constants.
+ *
+ * @param LINE line number from 1 to 4.
+ * @param COLUMN first column of the field, from 0.
+ * @param WIDTH number of characters, the field must not go past the end of
+ *              the line.
+ */
+#define LCD_FIELD( LINE , COLUMN , WIDTH ) LCD_SHADOW_INDEX( LINE , COLUMN ) , (WIDTH)
+
+/**
+ * @brief Shows a screen declared with ::LCD_SCREEN.
+ *
+ * Fields keep the text of the image until they are filled.
+ *
+ * @param screen screen in flash.
+ */
+void lcd_screen_show(const char *screen)
+{
+	memcpy_P( lcd_shadow , screen , LCD_MAX_CHARS );
+	lcd_async_update();
+}
+
+/**
+ * @brief Fills a field of the screen.
+ *
+ * The text is cut at the width of the field, the rest of the field is filled
+ * with spaces. Use it with ::LCD_FIELD:
+ * \code
+ * lcd_screen_field( LCD_FIELD( 3 , 11 , 4 ) , "12" );
+ * \endcode
+ *
+ * @param cell index into ::lcd_shadow of the first character.
+ * @param width number of characters of the field.
+ * @param text string that should be shown.
+ */
+void lcd_screen_field(uint8_t cell, uint8_t width, const char *text)
+{
+	char *field = &lcd_shadow[ cell ];
+
+	while ( width-- )
+	{
+		*field++ = *text ? *text++ : ' ';
+	}
+	lcd_async_update();
+}
+
+#endif /* LCD_SCREEN_H_INCLUDED */
@@ -0,0 +1,184 @@
+/** @file
+ * @brief Compile time calculation of the LCD bus timing.
+ *
+ * Works out ::LCD_CLOCKDIVISION, ::LCD_EXTRA_DIV and ::LCD_TOP_DIV from
+ * \b F_CPU and the timing limits of the ST7066, so the display runs as fast
+ * as it may on every board without trying values by hand. Values that are
+ * set by hand are checked against the same limits, and the build fails if
+ * they are too fast for the display.
+ *
+ * The limits, each multiplied with ::LCD_TIMING_MARGIN:
+ *
+ * <ul>
+ * 	<li>The enable pulse (high phase, ::LCD_EXTRA_DIV) must last at least
+ * 	    ::LCD_T_PW_NS.</li>
+ * 	<li>One nibble (::LCD_TOP_DIV) must last at least ::LCD_T_CYCLE_NS, and
+ * 	    at least ::LCD_T_EXEC_NS. Without the busy flag, the time between
+ * 	    two bytes is all the display gets to execute the first one.</li>
+ * 	<li>Both phases must last at least ::LCD_MIN_PHASE_CYCLES, so the
+ * 	    interrupt of lcd_async.h is done before its next compare match.</li>
+ * 	<li>Timer 1 must be able to count ::LCD_TIMER_RANGE_US with the chosen
+ * 	    clock division, for the longest waits of lcd_async.h and
+ * 	    lcd_marquee.h.</li>
+ * </ul>
+ *
+ * The smallest clock division that covers ::LCD_TIMER_RANGE_US is used, it
+ * gives the finest steps. All values are plain constants.
+ *
+ * @pre \b F_CPU must be defined before this file is included. It is
+ *      included by display.h.
+ */
+
+#ifndef LCD_TIMING_H_INCLUDED
+#define LCD_TIMING_H_INCLUDED
+
+#ifndef F_CPU
+#error "F_CPU must be defined before lcd_timing.h is included"
+#endif
+
+#ifndef LCD_T_PW_NS
+/**
+ * @brief Shortest enable pulse of the ST7066 in nanoseconds.
+ *
+ * 480 ns is the data sheet value for 2.7 to 4.5 V, it also covers 5 V.
+ */
+#define LCD_T_PW_NS 480ULL
+#endif
+
+#ifndef LCD_T_CYCLE_NS
+/**
+ * @brief Shortest enable cycle of the ST7066 in nanoseconds.
+ *
+ * 1400 ns is the data sheet value for 2.7 to 4.5 V, it also covers 5 V.
+ */
+#define LCD_T_CYCLE_NS 1400ULL
+#endif
+
+#ifndef LCD_T_EXEC_NS
+/**
+ * @brief Execution time of a command or character in nanoseconds.
+ *
+ * 37 us at the typical oscillator frequency of 270 kHz. Clear and return
+ * home take longer and are waited for separately.
+ */
+#define LCD_T_EXEC_NS 37000ULL
+#endif
+
+#ifndef LCD_TIMING_MARGIN
+/**
+ * @brief Safety margin in percent of the data sheet values.
+ *
+ * 125 means every limit is stretched by 25 %, to cover the spread of the
+ * display oscillator. Can be overridden by defining it before display.h is
+ * included.
+ */
+#define LCD_TIMING_MARGIN 125ULL
+#endif
+
+#ifndef LCD_MIN_PHASE_CYCLES
+/**
+ * @brief Shortest high or low phase of the enable clock in CPU cycles.
+ *
+ * Each phase is one interrupt in lcd_async.h, this leaves room for the
+ * interrupt and for other interrupts that delay it.
+ */
+#define LCD_MIN_PHASE_CYCLES 200ULL
+#endif
+
+#ifndef LCD_TIMER_RANGE_US
+/**
+ * @brief Longest time timer 1 has to count for the display, in microseconds.
+ *
+ * The power on wait of lcd_async.h is 15 ms, the marquee tick of
+ * lcd_marquee.h is 10 ms.
+ */
+#define LCD_TIMER_RANGE_US 15000ULL
+#endif
+
+/**
+ * @brief CPU cycles for a time in nanoseconds, with margin, rounded up.
+ */
+#define LCD_NS_TO_CYCLES( NS ) \
+	( ( (NS) * (F_CPU) * LCD_TIMING_MARGIN + 100000000000ULL - 1 ) / 100000000000ULL )
+
+/**
+ * @brief The bigger of two values.
+ */
+#define LCD_TIMING_MAX( A , B ) ( (A) > (B) ? (A) : (B) )
+
+/**
+ * @brief Shortest enable high phase in CPU cycles.
+ */
+#define LCD_HIGH_MIN_CYCLES \
+	LCD_TIMING_MAX( LCD_NS_TO_CYCLES( LCD_T_PW_NS ) , LCD_MIN_PHASE_CYCLES )
+
+/**
+ * @brief Shortest enable low phase in CPU cycles.
+ */
+#define LCD_LOW_MIN_CYCLES \
+	LCD_TIMING_MAX( LCD_NS_TO_CYCLES( LCD_T_CYCLE_NS - LCD_T_PW_NS ) , LCD_MIN_PHASE_CYCLES )
+
+/**
+ * @brief Shortest nibble in CPU cycles for a given high phase.
+ *
+ * @param HIGH_CYCLES high phase in CPU cycles.
+ */
+#define LCD_NIBBLE_MIN_CYCLES( HIGH_CYCLES ) LCD_TIMING_MAX( \
+	LCD_TIMING_MAX( LCD_NS_TO_CYCLES( LCD_T_EXEC_NS ) , LCD_NS_TO_CYCLES( LCD_T_CYCLE_NS ) ) , \
+	(HIGH_CYCLES) + LCD_LOW_MIN_CYCLES )
+
+/**
+ * @brief CPU cycles of ::LCD_TIMER_RANGE_US.
+ */
+#define LCD_RANGE_CYCLES ( LCD_TIMER_RANGE_US * (F_CPU) / 1000000ULL )
+
+/**
+ * @brief Smallest clock division of ::T1_START that covers
+ *        ::LCD_TIMER_RANGE_US.
+ */
+#if LCD_RANGE_CYCLES <= 0xFFFFULL
+# define LCD_AUTO_CLOCKDIVISION 1
+#elif LCD_RANGE_CYCLES <= 0xFFFFULL * 8
+# define LCD_AUTO_CLOCKDIVISION 8
+#elif LCD_RANGE_CYCLES <= 0xFFFFULL * 64
+# define LCD_AUTO_CLOCKDIVISION 64
+#elif LCD_RANGE_CYCLES <= 0xFFFFULL * 256
+# define LCD_AUTO_CLOCKDIVISION 256
+#else
+# define LCD_AUTO_CLOCKDIVISION 1024
+#endif
+
+/**
+ * @brief Shortest legal ::LCD_EXTRA_DIV for ::LCD_CLOCKDIVISION.
+ */
+#define LCD_AUTO_EXTRA_DIV \
+	( ( LCD_HIGH_MIN_CYCLES + LCD_CLOCKDIVISION - 1 ) / LCD_CLOCKDIVISION )
+
+/**
+ * @brief Shortest legal ::LCD_TOP_DIV for ::LCD_CLOCKDIVISION and
+ *        ::LCD_EXTRA_DIV.
+ */
+#define LCD_AUTO_TOP_DIV \
+	( ( LCD_NIBBLE_MIN_CYCLES( LCD_EXTRA_DIV * LCD_CLOCKDIVISION ) \
+	    + LCD_CLOCKDIVISION - 1 ) / LCD_CLOCKDIVISION )
+
+/* Checks of the values in use, set by hand or not. */
+
+#if LCD_CLOCKDIVISION != 1 && LCD_CLOCKDIVISION != 8 && LCD_CLOCKDIVISION != 64 \
+ && LCD_CLOCKDIVISION != 256 && LCD_CLOCKDIVISION != 1024
+#error "LCD_CLOCKDIVISION must be 1, 8, 64, 256 or 1024, see T1_START"
+#endif
+
+#if LCD_EXTRA_DIV * LCD_CLOCKDIVISION < LCD_HIGH_MIN_CYCLES
+#error "LCD_EXTRA_DIV gives an enable pulse that is too short for the display"
+#endif
+
+#if LCD_TOP_DIV * LCD_CLOCKDIVISION < LCD_NIBBLE_MIN_CYCLES( LCD_EXTRA_DIV * LCD_CLOCKDIVISION )
+#error "LCD_TOP_DIV gives a nibble that is too short for the display"
+#endif
+
+#if LCD_TOP_DIV > 0xFFFF
+#error "LCD_TOP_DIV does not fit timer 1, use a bigger LCD_CLOCKDIVISION"
+#endif
+
+#endif /* LCD_TIMING_H_INCLUDED */
@@ -0,0 +1,206 @@
+#include <stdint.h>
+
+/** @file
+ * @brief Stackless threads for flows that wait, e.g. reading a card.
+ *
+ * A protothread is a function that can wait in the middle and go on from
+ * there when it is called the next time. All threads share the stack of
+ * main(), each one only keeps the line it waits on in a struct pt, two
+ * bytes of RAM. Several flows can so wait at the same time without blocking
+ * each other, and each one reads from top to bottom instead of as a switch
+ * over states.
+ *
+ * The line is stored with a switch statement, so:
+ *
+ * <ul>
+ * 	<li>local variables are lost while the thread waits, values that are
+ * 	    needed after a wait must be static or in a struct,</li>
+ * 	<li>a thread must not use switch itself around a wait,</li>
+ * 	<li>only the thread function itself can wait, not functions it
+ * 	    calls.</li>
+ * </ul>
+ *
+ * A thread returns ::PT_WAITING when it waits for an interrupt and
+ * ::PT_YIELDED when it wants to run again soon, e.g. because a queue is full
+ * and nothing will tell it when there is room. With event_loop.h the handler
+ * posts its event again for ::PT_YIELDED.
+ *
+ * Example:
+ * \code
+ * static struct pt blink_pt;
+ * static struct soft_timer blink_timer = { .callback = on_blink_timer };
+ *
+ * PT_THREAD( blink( struct pt *pt ) )
+ * {
+ * 	PT_BEGIN( pt );
+ * 	while(1)
+ * 	{
+ * 		PT_WAIT_UNTIL( pt , button_pressed );
+ * 		LED_ON;
+ * 		PT_WAIT_UNTIL_TIMEOUT( pt , 0 , &blink_timer , SOFT_TIMER_MS( 500 ) );
+ * 		LED_OFF;
+ * 	}
+ * 	PT_END( pt );
+ * }
+ *
+ * PT_INIT( &blink_pt );
+ * ...
+ * blink( &blink_pt );
+ * \endcode
+ *
+ * @pre soft_timer.h must be included before ::PT_WAIT_UNTIL_TIMEOUT is used.
+ */
+
+#ifndef PROTOTHREAD_H_INCLUDED
+#define PROTOTHREAD_H_INCLUDED
+
+/**
+ * @brief The thread waits for a condition that an interrupt changes.
+ */
+#define PT_WAITING 0
+
+/**
+ * @brief The thread waits for a condition that has to be polled, it should
+ *        be called again soon.
+ */
+#define PT_YIELDED 1
+
+/**
+ * @brief The thread left with ::PT_EXIT and starts over on the next call.
+ */
+#define PT_EXITED 2
+
+/**
+ * @brief The thread reached ::PT_END and starts over on the next call.
+ */
+#define PT_ENDED 3
+
+/**
+ * @brief State of a protothread.
+ */
+struct pt
+{
+	uint16_t lc; /**< line the thread waits on, 0 before the first line */
+};
+
+/**
+ * @brief Sets a thread to its start, before it is called the first time.
+ *
+ * @param PT pointer to the struct pt of the thread.
+ */
+#define PT_INIT( PT ) do{ (PT)->lc = 0; }while(0)
+
+/**
+ * @brief Declares a thread function.
+ *
+ * @param NAME_ARGS name and parameters of the function, one of them the
+ *                  struct pt.
+ */
+#define PT_THREAD( NAME_ARGS ) char NAME_ARGS
+
+/**
+ * @brief Starts the body of a thread, goes on where it waited.
+ *
+ * @param PT pointer to the struct pt of the thread.
+ */
+#define PT_BEGIN( PT ) { char pt_resumed = 1; (void)pt_resumed; switch( (PT)->lc ) { case 0:
+
+/**
+ * @brief Ends the body of a thread. The thread starts over on the next call.
+ *
+ * @param PT pointer to the struct pt of the thread.
+ */
+#define PT_END( PT ) } (PT)->lc = 0; return PT_ENDED; }
+
+/**
+ * @brief Waits until a condition is true, returns ::PT_WAITING meanwhile.
+ *
+ * Goes on at once if the condition is true already.
+ *
+ * @param PT pointer to the struct pt of the thread.
+ * @param CONDITION checked on every call of the thread.
+ */
+#define PT_WAIT_UNTIL( PT , CONDITION ) do{ \
+		(PT)->lc = __LINE__; case __LINE__: \
+		if ( !( CONDITION ) ) { return PT_WAITING; } \
+	}while(0)
+
+/**
+ * @brief Waits while a condition is true, returns ::PT_WAITING meanwhile.
+ *
+ * @param PT pointer to the struct pt of the thread.
+ * @param CONDITION checked on every call of the thread.
+ */
+#define PT_WAIT_WHILE( PT , CONDITION ) PT_WAIT_UNTIL( PT , !( CONDITION ) )
+
+/**
+ * @brief Waits until one of the given events came.
+ *
+ * @param PT pointer to the struct pt of the thread.
+ * @param EVENTS events the thread was called with, e.g. from event_wait().
+ * @param MASK events to wait for.
+ */
+#define PT_WAIT_EVENT( PT , EVENTS , MASK ) PT_WAIT_UNTIL( PT , (EVENTS) & (MASK) )
+
+/**
+ * @brief Waits until a condition is true, returns ::PT_YIELDED meanwhile.
+ *
+ * For conditions no interrupt tells about, e.g. room in a queue. The
+ * condition may have side effects, it is true once it did its work:
+ * \code
+ * PT_POLL_UNTIL( pt , spi_async_submit( &txn ) );
+ * \endcode
+ *
+ * @param PT pointer to the struct pt of the thread.
+ * @param CONDITION checked on every call of the thread.
+ */
+#define PT_POLL_UNTIL( PT , CONDITION ) do{ \
+		(PT)->lc = __LINE__; case __LINE__: \
+		if ( !( CONDITION ) ) { return PT_YIELDED; } \
+	}while(0)
+
+/**
+ * @brief Waits until a condition is true or a time is over.
+ *
+ * Starts a one-shot soft_timer.h timer, which is stopped again when the
+ * condition comes true first. Afterwards \b TIMER->fired tells if the time
+ * was over. The callback of the timer should post an event that runs the
+ * thread, e.g. ::EVENT_TIMER.
+ *
+ * @param PT pointer to the struct pt of the thread.
+ * @param CONDITION checked on every call of the thread, 0 to only wait.
+ * @param TIMER pointer to a struct soft_timer only used by this thread.
+ * @param TICKS time to wait at most, in ticks of soft_timer.h.
+ */
+#define PT_WAIT_UNTIL_TIMEOUT( PT , CONDITION , TIMER , TICKS ) do{ \
+		soft_timer_start( (TIMER) , (TICKS) , 0 ); \
+		PT_WAIT_UNTIL( PT , (CONDITION) || (TIMER)->fired ); \
+		soft_timer_stop( TIMER ); \
+	}while(0)
+
+/**
+ * @brief Lets other threads run once, returns ::PT_YIELDED.
+ *
+ * @param PT pointer to the struct pt of the thread.
+ */
+#define PT_YIELD( PT ) do{ \
+		pt_resumed = 0; \
+		(PT)->lc = __LINE__; case __LINE__: \
+		if ( !pt_resumed ) { return PT_YIELDED; } \
+	}while(0)
+
+/**
+ * @brief Leaves the thread, it starts over on the next call.
+ *
+ * @param PT pointer to the struct pt of the thread.
+ */
+#define PT_EXIT( PT ) do{ (PT)->lc = 0; return PT_EXITED; }while(0)
+
+/**
+ * @brief Starts the thread over at once, returns ::PT_YIELDED.
+ *
+ * @param PT pointer to the struct pt of the thread.
+ */
+#define PT_RESTART( PT ) do{ (PT)->lc = 0; return PT_YIELDED; }while(0)
+
+#endif /* PROTOTHREAD_H_INCLUDED */
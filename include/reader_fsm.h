@@ -0,0 +1,120 @@
+#include <stdint.h>
+#include "fsm.h"
+
+/** @file
+ * @brief States, events and tables of the card reader.
+ *
+ * The reader waits for a card, reads its UID, waits until the card is taken
+ * away and then reports the UID to the HACS server:
+ *
+ * <table border="1">
+ * 	<tr><th>State</th><th>Event</th><th>Next state</th><th>Action</th></tr>
+ * 	<tr><td>IDLE</td><td>CARD_IN</td><td>START</td><td></td></tr>
+ * 	<tr><td>START</td><td>POLL</td><td>START</td><td>reader_start_read()</td></tr>
+ * 	<tr><td>START</td><td>DONE</td><td>READING</td><td></td></tr>
+ * 	<tr><td>READING</td><td>READ_END</td><td>REMOVE</td><td>reader_read_end()</td></tr>
+ * 	<tr><td>REMOVE</td><td>CARD_OUT</td><td>SEND</td><td></td></tr>
+ * 	<tr><td>SEND</td><td>POLL</td><td>SEND</td><td>reader_send_uid()</td></tr>
+ * 	<tr><td>SEND</td><td>DONE</td><td>IDLE</td><td></td></tr>
+ * </table>
+ *
+ * Entry actions: IDLE reader_check_card_in(), START reader_card_arrived(),
+ * REMOVE reader_check_card_out() and SEND reader_poll().
+ *
+ * This file only holds the tables. The actions are declared here and
+ * defined by the file that includes it, statemachine.c on the reader and
+ * fsm_test.c on the development computer, so both run the same tables.
+ */
+
+#ifndef READER_FSM_H_INCLUDED
+#define READER_FSM_H_INCLUDED
+
+#define READER_IDLE    0 /**< waits for a card */
+#define READER_START   1 /**< starts the UID read, again while the SPI queue is full */
+#define READER_READING 2 /**< waits until the read is done or aborted */
+#define READER_REMOVE  3 /**< waits until the card is taken away */
+#define READER_SEND    4 /**< sends the UID, again while the transmit buffer is full */
+#define READER_STATES  5 /**< number of states */
+
+#define READER_EV_CARD_IN  0 /**< a card is on the reader */
+#define READER_EV_CARD_OUT 1 /**< no card is on the reader */
+#define READER_EV_READ_END 2 /**< the UID read is done or aborted */
+#define READER_EV_POLL     3 /**< try the operation of the state again */
+#define READER_EV_DONE     4 /**< the operation of the state is done */
+#define READER_EVENTS      5 /**< number of events */
+
+/**
+ * @brief Looks for a card whose edge was dispatched before IDLE was entered.
+ *
+ * @return ::READER_EV_CARD_IN if a card is on the reader already.
+ */
+uint8_t reader_check_card_in(void);
+
+/**
+ * @brief Notes the time the card arrived.
+ *
+ * @return ::READER_EV_POLL.
+ */
+uint8_t reader_card_arrived(void);
+
+/**
+ * @brief Starts the UID read.
+ *
+ * @return ::READER_EV_DONE if it was started, ::FSM_NO_EVENT if the SPI
+ *         queue is full.
+ */
+uint8_t reader_start_read(void);
+
+/**
+ * @brief Notes how long the read took.
+ *
+ * @return ::FSM_NO_EVENT.
+ */
+uint8_t reader_read_end(void);
+
+/**
+ * @brief Looks for a card that was taken away before REMOVE was entered.
+ *
+ * @return ::READER_EV_CARD_OUT if the card is gone already.
+ */
+uint8_t reader_check_card_out(void);
+
+/**
+ * @brief Asks for the operation of the state to be tried.
+ *
+ * @return ::READER_EV_POLL.
+ */
+uint8_t reader_poll(void);
+
+/**
+ * @brief Reports the UID if the read was complete.
+ *
+ * @return ::READER_EV_DONE if it was sent or there is nothing to send,
+ *         ::FSM_NO_EVENT if the transmit buffer is full.
+ */
+uint8_t reader_send_uid(void);
+
+/**
+ * @brief Transitions of the reader.
+ */
+const struct fsm_transition reader_table[ READER_STATES ][ READER_EVENTS ] PROGMEM = {
+	[ READER_IDLE ][ READER_EV_CARD_IN ] = FSM_GO( READER_START , 0 ),
+	[ READER_START ][ READER_EV_POLL ] = FSM_GO( READER_START , reader_start_read ),
+	[ READER_START ][ READER_EV_DONE ] = FSM_GO( READER_READING , 0 ),
+	[ READER_READING ][ READER_EV_READ_END ] = FSM_GO( READER_REMOVE , reader_read_end ),
+	[ READER_REMOVE ][ READER_EV_CARD_OUT ] = FSM_GO( READER_SEND , 0 ),
+	[ READER_SEND ][ READER_EV_POLL ] = FSM_GO( READER_SEND , reader_send_uid ),
+	[ READER_SEND ][ READER_EV_DONE ] = FSM_GO( READER_IDLE , 0 ),
+};
+
+/**
+ * @brief Entry and exit actions of the reader states.
+ */
+const struct fsm_state reader_states[ READER_STATES ] PROGMEM = {
+	[ READER_IDLE ] = { reader_check_card_in , 0 },
+	[ READER_START ] = { reader_card_arrived , 0 },
+	[ READER_REMOVE ] = { reader_check_card_out , 0 },
+	[ READER_SEND ] = { reader_poll , 0 },
+};
+
+#endif /* READER_FSM_H_INCLUDED */
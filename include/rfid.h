@@ -30,6 +30,18 @@
  */
 #define CARD_PRES  ( PIND &(1<<PD2))
 
+/**
+ * @brief Command that makes the RFID module read the card.
+ *
+ * When the module has the card data in its buffer, DATA_READY goes high.
+ */
+#define RFID_CMD_READ 0x55
+
+/**
+ * @brief Command that clocks one byte of card data out of the RFID module.
+ */
+#define RFID_CMD_FETCH 0xF5
+
 /**
  * @brief data to be stored inside the buffer
  *
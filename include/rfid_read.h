@@ -0,0 +1,231 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include "rfid.h"
+#include "spi_async.h"
+#include "ext_interrupt.h"
+#include "timers.h"
+
+/**
+ * @file
+ * @brief Reads the card UID from the RFID module in the background.
+ *
+ * rfid_read_start() sends ::RFID_CMD_READ and returns. When the module raises
+ * DATA_READY (INT1), the UID bytes are clocked into BUFFER by the SPI
+ * interrupt. Two read modes exist:
+ *
+ * <ul>
+ * 	<li>Burst (::rfid_read_gap is 0): the bytes are clocked out back to back
+ * 	    as long as DATA_READY stays high. If it goes low, the read pauses
+ * 	    until the next rising edge.</li>
+ * 	<li>Paced (::rfid_read_gap above 0): one byte is clocked out every
+ * 	    ::rfid_read_gap timer 0 ticks while DATA_READY is high, like the
+ * 	    old read_data state did.</li>
+ * </ul>
+ *
+ * In both modes timer 0 runs as a watchdog while a read is going on. If the
+ * UID is not complete after ::RFID_READ_TIMEOUT ticks, plus 8 times
+ * ::rfid_read_gap in paced mode, the read is aborted. The paced read of the
+ * 8 UID bytes needs at least 8 gaps, so the watchdog is stretched by them
+ * and any gap up to 255 ticks can be used.
+ *
+ * @pre \b F_CPU must be defined. spi_async_init() must have been called.
+ *
+ * @warning Timer 0 and INT1 are used while a read is going on.
+ */
+
+#ifndef RFID_READ_H_INCLUDED
+#define RFID_READ_H_INCLUDED
+
+/**
+ * @brief Tick of timer 0 while reading, in microseconds.
+ *
+ * Clock division and TOP are chosen by ::T0_CTC_CYCLES( CYCLES ).
+ */
+#define RFID_TICK_US 100
+
+#ifndef RFID_READ_GAP
+/**
+ * @brief Default gap between two UID bytes, in ticks of 100 microseconds.
+ *
+ * 0 selects the burst mode. Can be overridden by defining it before this file
+ * is included, or at run time with ::rfid_read_gap.
+ */
+#define RFID_READ_GAP 0
+#endif
+
+#ifndef RFID_READ_TIMEOUT
+/**
+ * @brief Time a whole UID read may take, in ticks of 100 microseconds.
+ *
+ * Counted from rfid_read_start(), 8 times ::rfid_read_gap are added to it
+ * in paced mode. Can be overridden by defining it before this file is
+ * included.
+ */
+#define RFID_READ_TIMEOUT 500
+#endif
+
+#if RFID_READ_TIMEOUT + 8 * 255 > 0xFFFF
+#error "RFID_READ_TIMEOUT plus 8 gaps of 255 ticks must fit the 16 bit watchdog"
+#endif
+
+/**
+ * @brief Gap between two UID bytes in ticks, 0 for burst mode.
+ */
+uint8_t rfid_read_gap = RFID_READ_GAP;
+
+/**
+ * @brief Called from the interrupts whenever the read made progress, may be 0.
+ *
+ * Lets the main loop know that it should have a look at rfid_read_status(),
+ * e.g. to keep it from going to sleep.
+ */
+void (*rfid_read_event)(void) = 0;
+
+/**
+ * @brief Ticks left until the watchdog aborts the read.
+ */
+static volatile uint16_t rfid_watchdog = 0;
+
+/**
+ * @brief Ticks since the last UID byte in paced mode.
+ */
+static volatile uint8_t rfid_gap_ticks = 0;
+
+/**
+ * @brief Tells the SPI engine if the module has more data.
+ */
+static uint8_t rfid_data_ready(void)
+{
+	return DATA_READY != 0;
+}
+
+/**
+ * @brief Command bytes that start reading a card.
+ */
+const uint8_t rfid_read_command[] = { RFID_CMD_READ };
+
+/**
+ * @brief SPI transaction that reads the card UID into BUFFER.
+ */
+struct spi_transaction rfid_uid_read = {
+	rfid_read_command , sizeof( rfid_read_command ) ,
+	(uint8_t *)BUFFER , sizeof( BUFFER ) , RFID_CMD_FETCH ,
+	SPI_TXN_WAIT_READY , 0 , 0
+};
+
+/**
+ * @brief Stops the watchdog and disarms DATA_READY.
+ *
+ * Called from the SPI interrupt when the read is done or aborted.
+ */
+static void rfid_read_complete(struct spi_transaction *transaction)
+{
+	T0_CTC_INT_OFF;
+	T0_STOP;
+	EXT_INT1_DIS;
+	if ( rfid_read_event )
+	{
+		rfid_read_event();
+	}
+}
+
+/**
+ * @brief Starts reading a card UID.
+ *
+ * Returns at once. The result can be polled with rfid_read_status(),
+ * ::rfid_read_event is called when the read ends.
+ *
+ * @return 1 if the read was started, 0 if the SPI queue is full.
+ */
+uint8_t rfid_read_start(void)
+{
+	rfid_uid_read.flags = SPI_TXN_WAIT_READY;
+	rfid_uid_read.ready = 0;
+	if ( rfid_read_gap )
+	{
+		rfid_uid_read.flags |= SPI_TXN_PACED;
+	}
+	else
+	{
+		rfid_uid_read.ready = rfid_data_ready;
+	}
+	rfid_uid_read.complete = rfid_read_complete;
+
+	/* Watchdog and gap timer. The paced read needs one gap per UID byte
+	 * on top of the time of the module. */
+	rfid_watchdog = RFID_READ_TIMEOUT + sizeof( BUFFER ) * rfid_read_gap;
+	rfid_gap_ticks = 0;
+	T0_STOP;
+	T0_RESET;
+	T0_COMP_MATCH_CLEAR;
+	T0_CTC_INT_ON;
+	T0_CTC_CYCLES( TIMER_US_CYCLES( RFID_TICK_US ) );
+
+	/* Data ready must be armed before the command goes out. */
+	EXT_INT1_RISING;
+	EXT_INT1_CLEAR;
+	EXT_INT1_EN;
+
+	if ( !spi_async_submit( &rfid_uid_read ) )
+	{
+		T0_CTC_INT_OFF;
+		T0_STOP;
+		EXT_INT1_DIS;
+		return 0;
+	}
+	/* In case DATA_READY is high already, no edge would come. */
+	if ( DATA_READY )
+	{
+		spi_async_resume();
+	}
+	return 1;
+}
+
+/**
+ * @brief Status of the last UID read.
+ *
+ * @return ::SPI_TXN_DONE when the UID is in BUFFER, ::SPI_TXN_ABORTED when the
+ *         watchdog stopped the read, another SPI_TXN_* value while it runs.
+ */
+uint8_t rfid_read_status(void)
+{
+	return rfid_uid_read.status;
+}
+
+/**
+ * @brief interrupt service routine for DATA_READY
+ *
+ * The module has data, continue the read.
+ */
+ISR(INT1_vect)
+{
+	spi_async_resume();
+	if ( rfid_read_event )
+	{
+		rfid_read_event();
+	}
+}
+
+/**
+ * @brief interrupt service routine for the read watchdog and the gap timer
+ */
+ISR(TIMER0_COMP_vect)
+{
+	if ( --rfid_watchdog == 0 )
+	{
+		spi_async_abort( &rfid_uid_read );
+		return;
+	}
+	if ( rfid_read_gap && rfid_uid_read.status == SPI_TXN_WAITING
+	  && rfid_uid_read.in_data )
+	{
+		if ( ++rfid_gap_ticks >= rfid_read_gap && DATA_READY )
+		{
+			rfid_gap_ticks = 0;
+			spi_async_resume();
+		}
+	}
+}
+
+#endif /* RFID_READ_H_INCLUDED */
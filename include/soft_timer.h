@@ -0,0 +1,437 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include <util/atomic.h>
+
+/** @file
+ * @brief Many timers on timer 2.
+ *
+ * Timer 0 is taken by rfid_read.h and timer 1 by lcd_async.h, so there is no
+ * hardware timer left for debouncing, timeouts or a heartbeat. This file
+ * runs any number of software timers on timer 2. Each is a struct
+ * soft_timer owned by the caller, either one-shot or periodic. When it
+ * expires, its \b fired flag is set and its callback, if any, is called from
+ * the interrupt.
+ *
+ * The running timers are kept in a list sorted by expiry. Each entry holds
+ * its time after the entry before it, so a tick only has to count down the
+ * first entry, no matter how many timers run. Starting and stopping a timer
+ * walks the list.
+ *
+ * Three ways of running timer 2 can be chosen when building:
+ *
+ * <ul>
+ * 	<li>By default the interrupt comes every tick of about 1 ms.</li>
+ * 	<li>With ::SOFT_TIMER_TICKLESS defined, a tick is one count of timer 2,
+ * 	    102.4 us at 10 MHz. The compare register is set to the next expiry,
+ * 	    at most 256 counts ahead, so the interrupt only comes when a timer
+ * 	    expires or every 26 ms. Timer 2 stops when no timer runs. This
+ * 	    suits the sleeping main loop.</li>
+ * 	<li>If dimmer.h is included before this file, timer 2 runs its phase
+ * 	    correct PWM and a tick is one PWM period of 510 counts, 408 us at
+ * 	    10 MHz. The soft timers are counted from ::dimmer_tick in the
+ * 	    overflow interrupt of the dimmer, which stays on from
+ * 	    soft_timer_init() on. The tickless mode can not be used then.</li>
+ * </ul>
+ *
+ * Times are given in ticks, ::SOFT_TIMER_MS converts from milliseconds for
+ * both ways.
+ *
+ * Example:
+ * \code
+ * struct soft_timer heartbeat = { .callback = toggle_led };
+ * struct soft_timer timeout;
+ *
+ * soft_timer_init();
+ * sei();
+ * soft_timer_start( &heartbeat , SOFT_TIMER_MS( 500 ) , SOFT_TIMER_MS( 500 ) );
+ * soft_timer_start( &timeout , SOFT_TIMER_MS( 2000 ) , 0 );
+ * ...
+ * if ( soft_timer_expired( &timeout ) )
+ * { ... }
+ * \endcode
+ *
+ * @pre \b F_CPU must be defined and timers.h included before this file.
+ */
+
+#ifndef SOFT_TIMER_H_INCLUDED
+#define SOFT_TIMER_H_INCLUDED
+
+#ifdef DIMMER_H_INCLUDED
+
+# ifdef SOFT_TIMER_TICKLESS
+#  error "SOFT_TIMER_TICKLESS needs timer 2 to itself, it can not be used with dimmer.h"
+# endif
+
+/**
+ * @brief Clock division of timer 2, taken from dimmer.h.
+ */
+# define SOFT_TIMER_CLOCKDIVISION DIMMER_CLOCKDIVISION
+
+/**
+ * @brief Counts of timer 2 per tick, one phase correct PWM period.
+ */
+# define SOFT_TIMER_TICK_COUNTS 510
+
+#elif defined( SOFT_TIMER_TICKLESS )
+
+# ifndef SOFT_TIMER_CLOCKDIVISION
+/**
+ * @brief Clock division of timer 2, see ::T2_START_DIV.
+ */
+#  define SOFT_TIMER_CLOCKDIVISION 1024
+# endif
+
+/**
+ * @brief Counts of timer 2 per tick.
+ */
+# define SOFT_TIMER_TICK_COUNTS 1
+
+#else
+
+# ifndef SOFT_TIMER_CLOCKDIVISION
+/**
+ * @brief Clock division of timer 2, see ::T2_START_DIV.
+ */
+#  define SOFT_TIMER_CLOCKDIVISION 64
+# endif
+
+/**
+ * @brief Counts of timer 2 per tick, as close to 1 ms as timer 2 can.
+ */
+# define SOFT_TIMER_TICK_COUNTS ( F_CPU / SOFT_TIMER_CLOCKDIVISION / 1000 )
+
+# if SOFT_TIMER_TICK_COUNTS > 256 || SOFT_TIMER_TICK_COUNTS < 1
+#  error "1 ms does not fit timer 2, change SOFT_TIMER_CLOCKDIVISION"
+# endif
+
+#endif /* DIMMER_H_INCLUDED, SOFT_TIMER_TICKLESS */
+
+/**
+ * @brief Ticks for a time in milliseconds, rounded down.
+ *
+ * @param MS time in milliseconds. The result must fit 16 bits.
+ */
+#define SOFT_TIMER_MS( MS ) ( (uint16_t)( (uint32_t)( F_CPU / 1000 ) * (MS) \
+	/ ( (uint32_t)SOFT_TIMER_CLOCKDIVISION * SOFT_TIMER_TICK_COUNTS ) ) )
+
+/**
+ * @brief A software timer.
+ *
+ * Only \b callback may be set by the caller. The other members belong to
+ * this file while the timer runs.
+ */
+struct soft_timer
+{
+	struct soft_timer *next; /**< next timer in the list */
+	uint16_t delta;          /**< ticks after the timer before in the list */
+	uint16_t period;         /**< ticks between expiries, 0 for one-shot */
+	void (*callback)(void);  /**< called in the interrupt on expiry, or 0 */
+	volatile uint8_t fired;  /**< set on expiry, see soft_timer_expired() */
+	uint8_t active;          /**< 1 while the timer is in the list */
+};
+
+/**
+ * @brief First timer to expire, 0 if none runs.
+ */
+static struct soft_timer *soft_timer_head = 0;
+
+#ifdef SOFT_TIMER_TICKLESS
+/**
+ * @brief Ticks from the last compare match to the next one, 0 while timer 2
+ *        is stopped.
+ */
+static uint16_t soft_timer_step = 0;
+#endif
+
+/**
+ * @brief Ticks the start of the list lies behind the last compare match
+ *        while soft_timer_advance() handles expired timers, 0 otherwise.
+ *
+ * An expired timer may have been due before the match, e.g. when the
+ * callbacks before it took longer than its delta.
+ */
+static uint16_t soft_timer_behind = 0;
+
+/**
+ * @brief Puts a timer into the list.
+ *
+ * @pre Interrupts must be disabled.
+ *
+ * @param timer timer that is not in the list.
+ * @param delay ticks from the start of the list, at least 1.
+ */
+static void soft_timer_insert(struct soft_timer *timer, uint16_t delay)
+{
+	struct soft_timer **link = &soft_timer_head;
+
+	while ( *link && (*link)->delta <= delay )
+	{
+		delay -= (*link)->delta;
+		link = &(*link)->next;
+	}
+	if ( *link )
+	{
+		(*link)->delta -= delay;
+	}
+	timer->delta = delay;
+	timer->next = *link;
+	timer->active = 1;
+	*link = timer;
+}
+
+/**
+ * @brief Moves the start of the list on and handles expired timers.
+ *
+ * Periodic timers are put back into the list relative to their expiry, so
+ * they do not drift.
+ *
+ * @pre Interrupts must be disabled.
+ *
+ * @param elapsed ticks since the start of the list.
+ */
+static void soft_timer_advance(uint16_t elapsed)
+{
+	struct soft_timer *timer;
+
+	while ( soft_timer_head && soft_timer_head->delta <= elapsed )
+	{
+		timer = soft_timer_head;
+		elapsed -= timer->delta;
+		soft_timer_behind = elapsed;
+		soft_timer_head = timer->next;
+		timer->active = 0;
+		if ( timer->period )
+		{
+			soft_timer_insert( timer , timer->period );
+		}
+		timer->fired = 1;
+		if ( timer->callback )
+		{
+			timer->callback();
+		}
+	}
+	soft_timer_behind = 0;
+	if ( soft_timer_head )
+	{
+		soft_timer_head->delta -= elapsed;
+	}
+}
+
+#ifdef SOFT_TIMER_TICKLESS
+/**
+ * @brief Sets the compare register to the first expiry, or stops timer 2.
+ *
+ * @pre Interrupts must be disabled and timer 2 must run if
+ *      ::soft_timer_step is not 0.
+ */
+static void soft_timer_program(void)
+{
+	uint16_t step;
+
+	if ( !soft_timer_head )
+	{
+		T2_STOP;
+		T2_RESET;
+		soft_timer_step = 0;
+		return;
+	}
+	if ( soft_timer_step == 0 )
+	{
+		T2_RESET;
+		T2_COMP_MATCH_CLEAR;
+		T2_START_DIV( SOFT_TIMER_CLOCKDIVISION );
+	}
+	step = soft_timer_head->delta < 256 ? soft_timer_head->delta : 256;
+	if ( TCNT2 >= 254 )
+	{
+		/* The match of the current step is too close to move it. */
+		return;
+	}
+	if ( step < TCNT2 + 2 )
+	{
+		/* Two counts ahead, a match on the count that is just being
+		 * written would be missed. */
+		step = TCNT2 + 2;
+	}
+	OCR2 = step - 1;
+	soft_timer_step = step;
+}
+#endif
+
+/**
+ * @brief Counts down the first timer of the list, once per tick.
+ *
+ * @pre Interrupts must be disabled.
+ */
+static void soft_timer_tick(void)
+{
+	if ( soft_timer_head )
+	{
+		if ( --soft_timer_head->delta == 0 )
+		{
+			soft_timer_advance( 0 );
+		}
+	}
+}
+
+/**
+ * @brief Sets up timer 2 for the software timers.
+ *
+ * In the default mode timer 2 runs from now on. In the tickless mode it
+ * only runs while a timer does. With dimmer.h the ticks are taken from the
+ * dimmer, which is started by dimmer_init(), before or after this call.
+ */
+void soft_timer_init(void)
+{
+	soft_timer_head = 0;
+#ifdef DIMMER_H_INCLUDED
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		dimmer_tick = soft_timer_tick;
+		T2_OVF_INT_ON;
+	}
+#else
+	T2_STOP;
+	T2_RESET;
+# ifdef SOFT_TIMER_TICKLESS
+	soft_timer_step = 0;
+	T2_CTC( 0xFF );
+# else
+	T2_CTC( SOFT_TIMER_TICK_COUNTS - 1 );
+	T2_START_DIV( SOFT_TIMER_CLOCKDIVISION );
+# endif
+	T2_COMP_MATCH_CLEAR;
+	T2_CTC_INT_ON;
+#endif
+}
+
+/**
+ * @brief Takes a timer out of the list.
+ *
+ * @pre Interrupts must be disabled.
+ */
+static void soft_timer_remove(struct soft_timer *timer)
+{
+	struct soft_timer **link = &soft_timer_head;
+
+	while ( *link && *link != timer )
+	{
+		link = &(*link)->next;
+	}
+	if ( *link )
+	{
+		*link = timer->next;
+		if ( timer->next )
+		{
+			timer->next->delta += timer->delta;
+		}
+	}
+	timer->active = 0;
+}
+
+/**
+ * @brief Starts or restarts a timer.
+ *
+ * The timer expires after \b delay ticks, give or take one tick, and then
+ * every \b period ticks if \b period is not 0. Clears the \b fired flag.
+ * Can be called from callbacks, the delay is counted from the call then too,
+ * not from the expiry that called back.
+ *
+ * @param timer timer to start.
+ * @param delay ticks until the first expiry, at least 1.
+ * @param period ticks between the following expiries, 0 for one-shot.
+ */
+void soft_timer_start(struct soft_timer *timer, uint16_t delay, uint16_t period)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		if ( timer->active )
+		{
+			soft_timer_remove( timer );
+		}
+		timer->period = period;
+		timer->fired = 0;
+		if ( delay == 0 )
+		{
+			delay = 1;
+		}
+#ifdef SOFT_TIMER_TICKLESS
+		if ( soft_timer_step )
+		{
+			/* The list starts at the last compare match, or behind it
+			 * when called from a callback. TCNT2 counts from the
+			 * match. */
+			uint16_t since = TCNT2 + soft_timer_behind;
+
+			delay = delay > 0xFFFF - since ? 0xFFFF : delay + since;
+		}
+		soft_timer_insert( timer , delay );
+		if ( soft_timer_head == timer )
+		{
+			soft_timer_program();
+		}
+#else
+		soft_timer_insert( timer , delay );
+#endif
+	}
+}
+
+/**
+ * @brief Stops a timer.
+ *
+ * Does nothing if the timer does not run. The \b fired flag is kept.
+ *
+ * @param timer timer to stop.
+ */
+void soft_timer_stop(struct soft_timer *timer)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		if ( timer->active )
+		{
+			soft_timer_remove( timer );
+		}
+	}
+}
+
+/**
+ * @brief Tells if a timer expired and clears the flag.
+ *
+ * @param timer timer to check.
+ *
+ * @return 1 if the timer expired since the last call, 0 otherwise. Several
+ *         expiries of a periodic timer count as one.
+ */
+uint8_t soft_timer_expired(struct soft_timer *timer)
+{
+	uint8_t fired;
+
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		fired = timer->fired;
+		timer->fired = 0;
+	}
+	return fired;
+}
+
+#ifndef DIMMER_H_INCLUDED
+/**
+ * @brief interrupt service routine for the software timers
+ *
+ * Counts down the first timer of the list. Callbacks run here with
+ * interrupts disabled and should be short. With dimmer.h, the overflow
+ * interrupt of the dimmer does this.
+ */
+ISR(TIMER2_COMP_vect)
+{
+#ifdef SOFT_TIMER_TICKLESS
+	soft_timer_advance( soft_timer_step );
+	soft_timer_program();
+#else
+	soft_timer_tick();
+#endif
+}
+#endif
+
+#endif /* SOFT_TIMER_H_INCLUDED */
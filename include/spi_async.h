@@ -0,0 +1,445 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include <util/atomic.h>
+
+/**
+ * @file
+ * @brief Interrupt driven SPI transactions.
+ *
+ * A transaction sends a number of command bytes and then clocks in a number of
+ * data bytes, each by sending a fill byte. ISR(SPI_STC_vect) moves on to the
+ * next byte as soon as the previous one is shifted, so a transaction runs at
+ * the speed of the SPI clock while the main loop does other work.
+ *
+ * Transactions are queued; when one is done, the next one is started from the
+ * ISR. When a transaction is done, its \b status becomes ::SPI_TXN_DONE and
+ * its \b complete function is called, if there is one.
+ *
+ * Reading a card UID from the RFID module:
+ * \code
+ * static const uint8_t read_command[] = { RFID_CMD_READ };
+ * struct spi_transaction uid_read = {
+ * 	read_command , 1 , (uint8_t *)BUFFER , sizeof(BUFFER) , RFID_CMD_FETCH ,
+ * 	SPI_TXN_WAIT_READY , 0
+ * };
+ *
+ * spi_async_submit( &uid_read );
+ * ...
+ * // The module signals that its buffer is full:
+ * spi_async_resume();
+ * ...
+ * if ( uid_read.status == SPI_TXN_DONE ) { ... }
+ * \endcode
+ *
+ * @pre The SPI must be set up as master, e.g. with SPI_MasterInit(), and
+ *      spi_async_init() must be called before the first transaction.
+ *
+ * @warning Once spi_async_init() was called, SPI_MasterTransmit() must not be
+ *          used any more. The ISR would take its byte.
+ */
+
+#ifndef SPI_ASYNC_H_INCLUDED
+#define SPI_ASYNC_H_INCLUDED
+
+#ifndef SPI_QUEUE_SIZE
+/**
+ * @brief Number of transactions that can wait in the queue.
+ *
+ * Must be a power of two. Can be overridden by defining it before this file
+ * is included.
+ */
+#define SPI_QUEUE_SIZE 4
+#endif
+
+#if SPI_QUEUE_SIZE & ( SPI_QUEUE_SIZE - 1 )
+#error "SPI_QUEUE_SIZE must be a power of two"
+#endif
+
+/**
+ * @brief Transaction flag: pause after the command bytes.
+ *
+ * The data bytes are only clocked in after spi_async_resume() was called,
+ * e.g. when the slave signals that its data is ready.
+ */
+#define SPI_TXN_WAIT_READY 0x01
+
+/**
+ * @brief Transaction flag: pause after every data byte.
+ *
+ * Each further data byte is only clocked in after spi_async_resume() was
+ * called, e.g. from a timer that sets the gap between the bytes.
+ */
+#define SPI_TXN_PACED 0x02
+
+/**
+ * @brief Transaction status: waiting in the queue.
+ */
+#define SPI_TXN_QUEUED 0
+
+/**
+ * @brief Transaction status: bytes are being shifted.
+ */
+#define SPI_TXN_RUNNING 1
+
+/**
+ * @brief Transaction status: command sent, waiting for spi_async_resume().
+ */
+#define SPI_TXN_WAITING 2
+
+/**
+ * @brief Transaction status: all bytes shifted.
+ */
+#define SPI_TXN_DONE 3
+
+/**
+ * @brief Transaction status: stopped by spi_async_abort() before all bytes
+ *        were shifted.
+ */
+#define SPI_TXN_ABORTED 4
+
+/**
+ * @brief One SPI transaction.
+ *
+ * The first eight members are filled in by the user, the rest belongs to the
+ * engine.
+ */
+struct spi_transaction
+{
+	const uint8_t *command; /**< bytes sent first */
+	uint8_t command_length; /**< number of command bytes */
+	uint8_t *data;          /**< where the received data bytes are stored */
+	uint8_t data_length;    /**< number of data bytes to receive */
+	uint8_t fill;           /**< byte sent to clock in each data byte */
+	uint8_t flags;          /**< SPI_TXN_* flags */
+	/** called from the ISR when the transaction is done or aborted, may be 0 */
+	void (*complete)(struct spi_transaction *transaction);
+	/** checked before each further data byte, the transaction waits for
+	 *  spi_async_resume() while it returns 0; may be 0 */
+	uint8_t (*ready)(void);
+
+	volatile uint8_t status; /**< SPI_TXN_QUEUED .. SPI_TXN_ABORTED */
+	uint8_t index;           /**< next byte of the current phase */
+	uint8_t in_data;         /**< 0 while sending command bytes */
+};
+
+/**
+ * @brief Transaction that is being shifted, 0 if the engine is idle.
+ */
+static struct spi_transaction * volatile spi_current = 0;
+
+/**
+ * @brief Set if spi_async_resume() was called while the command bytes of the
+ *        current transaction were still being shifted.
+ */
+static volatile uint8_t spi_resume_pending = 0;
+
+/**
+ * @brief Set if spi_async_abort() was called while a byte of the current
+ *        transaction was being shifted.
+ */
+static volatile uint8_t spi_abort_pending = 0;
+
+/**
+ * @brief Queue of transactions that wait for the engine.
+ */
+static struct spi_transaction *spi_queue[ SPI_QUEUE_SIZE ];
+
+/**
+ * @brief Index of the next free queue slot.
+ */
+static volatile uint8_t spi_queue_head = 0;
+
+/**
+ * @brief Index of the next queued transaction.
+ */
+static volatile uint8_t spi_queue_tail = 0;
+
+/**
+ * @brief Enables the SPI serial transfer complete interrupt.
+ *
+ * @pre The SPI must be set up as master.
+ */
+void spi_async_init(void)
+{
+	SPCR |= _BV( SPIE );
+}
+
+/**
+ * @brief Starts clocking in the data bytes of the current transaction.
+ *
+ * Must be called with interrupts disabled.
+ */
+static void spi_start_data(struct spi_transaction *transaction)
+{
+	transaction->in_data = 1;
+	transaction->index = 0;
+	transaction->status = SPI_TXN_RUNNING;
+	SPDR = transaction->fill;
+}
+
+static void spi_finish(struct spi_transaction *transaction, uint8_t status);
+
+/**
+ * @brief Starts a transaction on the bus.
+ *
+ * A transaction without command bytes and with ::SPI_TXN_WAIT_READY waits
+ * for spi_async_resume() before its data bytes. One without any bytes is
+ * finished at once and the next queued one is started.
+ *
+ * Must be called with interrupts disabled.
+ */
+static void spi_start(struct spi_transaction *transaction)
+{
+	spi_current = transaction;
+	spi_resume_pending = 0;
+	spi_abort_pending = 0;
+	transaction->in_data = 0;
+	transaction->index = 0;
+	transaction->status = SPI_TXN_RUNNING;
+	if ( transaction->command_length )
+	{
+		SPDR = transaction->command[0];
+	}
+	else if ( transaction->flags & SPI_TXN_WAIT_READY )
+	{
+		/* No command to send, wait for the slave right away. */
+		transaction->status = SPI_TXN_WAITING;
+	}
+	else if ( transaction->data_length )
+	{
+		spi_start_data( transaction );
+	}
+	else
+	{
+		/* Nothing to shift. */
+		spi_finish( transaction , SPI_TXN_DONE );
+	}
+}
+
+/**
+ * @brief Finishes the current transaction and starts the next queued one.
+ *
+ * Must be called with interrupts disabled.
+ */
+static void spi_finish(struct spi_transaction *transaction, uint8_t status)
+{
+	spi_current = 0;
+	transaction->status = status;
+	if ( transaction->complete )
+	{
+		transaction->complete( transaction );
+	}
+	while ( !spi_current && spi_queue_tail != spi_queue_head )
+	{
+		struct spi_transaction *next = spi_queue[ spi_queue_tail ];
+
+		spi_queue_tail = ( spi_queue_tail + 1 ) & ( SPI_QUEUE_SIZE - 1 );
+		spi_start( next );
+	}
+}
+
+/**
+ * @brief Queues a transaction.
+ *
+ * The transaction is started at once if the engine is idle. It must stay
+ * valid until its status is ::SPI_TXN_DONE.
+ *
+ * @param transaction transaction to run.
+ *
+ * @return 1 if the transaction was queued or started, 0 if the queue is full.
+ */
+uint8_t spi_async_submit(struct spi_transaction *transaction)
+{
+	uint8_t queued = 1;
+
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		transaction->status = SPI_TXN_QUEUED;
+		if ( !spi_current )
+		{
+			spi_start( transaction );
+		}
+		else if ( ( ( spi_queue_head + 1 ) & ( SPI_QUEUE_SIZE - 1 ) ) == spi_queue_tail )
+		{
+			queued = 0;
+		}
+		else
+		{
+			spi_queue[ spi_queue_head ] = transaction;
+			spi_queue_head = ( spi_queue_head + 1 ) & ( SPI_QUEUE_SIZE - 1 );
+		}
+	}
+	return queued;
+}
+
+/**
+ * @brief Continues a transaction that waits after its command bytes.
+ *
+ * If the command bytes are still being shifted, the transaction continues
+ * with its data bytes right after them, so a ready signal that comes early is
+ * not lost. Does nothing if no transaction is running or waiting, so it is
+ * safe to call it from an interrupt or more than once.
+ *
+ * @see SPI_TXN_WAIT_READY
+ */
+void spi_async_resume(void)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		struct spi_transaction *transaction = spi_current;
+
+		if ( transaction && transaction->status == SPI_TXN_RUNNING
+		  && !transaction->in_data )
+		{
+			spi_resume_pending = 1;
+		}
+		else if ( transaction && transaction->status == SPI_TXN_WAITING
+		       && transaction->in_data )
+		{
+			/* Paused between two data bytes. */
+			transaction->status = SPI_TXN_RUNNING;
+			SPDR = transaction->fill;
+		}
+		else if ( transaction && transaction->status == SPI_TXN_WAITING )
+		{
+			if ( transaction->data_length )
+			{
+				spi_start_data( transaction );
+			}
+			else
+			{
+				spi_finish( transaction , SPI_TXN_DONE );
+			}
+		}
+	}
+}
+
+/**
+ * @brief Stops a transaction.
+ *
+ * A running or waiting transaction is stopped after the byte that is being
+ * shifted, a queued one is taken out of the queue. Its status becomes
+ * ::SPI_TXN_ABORTED and its \b complete function is called. Used e.g. by a
+ * watchdog when the slave does not answer.
+ *
+ * @param transaction transaction to stop.
+ */
+void spi_async_abort(struct spi_transaction *transaction)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		uint8_t i;
+
+		if ( transaction == spi_current && transaction->status == SPI_TXN_RUNNING )
+		{
+			/* A byte is being shifted, the ISR stops after it. */
+			spi_abort_pending = 1;
+		}
+		else if ( transaction == spi_current )
+		{
+			spi_finish( transaction , SPI_TXN_ABORTED );
+		}
+		else if ( transaction->status == SPI_TXN_QUEUED )
+		{
+			/* Replace it by a later entry to keep the queue order. */
+			for ( i = spi_queue_tail; i != spi_queue_head; i = ( i + 1 ) & ( SPI_QUEUE_SIZE - 1 ) )
+			{
+				if ( spi_queue[i] == transaction )
+				{
+					uint8_t j = i;
+
+					while ( ( ( j + 1 ) & ( SPI_QUEUE_SIZE - 1 ) ) != spi_queue_head )
+					{
+						spi_queue[j] = spi_queue[ ( j + 1 ) & ( SPI_QUEUE_SIZE - 1 ) ];
+						j = ( j + 1 ) & ( SPI_QUEUE_SIZE - 1 );
+					}
+					spi_queue_head = j;
+					transaction->status = SPI_TXN_ABORTED;
+					if ( transaction->complete )
+					{
+						transaction->complete( transaction );
+					}
+					break;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief Tells if the engine has nothing to do.
+ *
+ * @return 1 if no transaction is running, waiting or queued.
+ */
+uint8_t spi_async_idle(void)
+{
+	return !spi_current;
+}
+
+/**
+ * @brief interrupt service routine for serial transfer complete
+ *
+ * Stores the received data byte, if any, and shifts the next byte of the
+ * current transaction.
+ */
+ISR(SPI_STC_vect)
+{
+	struct spi_transaction *transaction = spi_current;
+
+	if ( !transaction || transaction->status != SPI_TXN_RUNNING )
+	{
+		return;
+	}
+
+	if ( spi_abort_pending )
+	{
+		spi_finish( transaction , SPI_TXN_ABORTED );
+		return;
+	}
+
+	if ( !transaction->in_data )
+	{
+		/* Command phase, the received byte is not of interest. */
+		transaction->index++;
+		if ( transaction->index < transaction->command_length )
+		{
+			SPDR = transaction->command[ transaction->index ];
+		}
+		else if ( ( transaction->flags & SPI_TXN_WAIT_READY ) && !spi_resume_pending )
+		{
+			transaction->status = SPI_TXN_WAITING;
+		}
+		else if ( transaction->data_length )
+		{
+			spi_start_data( transaction );
+		}
+		else
+		{
+			spi_finish( transaction , SPI_TXN_DONE );
+		}
+		return;
+	}
+
+	/* Data phase. */
+	transaction->data[ transaction->index++ ] = SPDR;
+	if ( transaction->index < transaction->data_length )
+	{
+		if ( ( transaction->flags & SPI_TXN_PACED )
+		  || ( transaction->ready && !transaction->ready() ) )
+		{
+			/* Wait for spi_async_resume(). */
+			transaction->status = SPI_TXN_WAITING;
+		}
+		else
+		{
+			SPDR = transaction->fill;
+		}
+	}
+	else
+	{
+		spi_finish( transaction , SPI_TXN_DONE );
+	}
+}
+
+#endif /* SPI_ASYNC_H_INCLUDED */
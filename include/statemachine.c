@@ -8,184 +8,339 @@
 #include <avr/io.h>
 #define F_CPU 10000000UL
 #include <util/delay.h>
+#include "baud.h"
 #include <string.h>
 #include "include/spi.h"
-#include "timer0.h"
+#include "spi_async.h"
+#include "rfid_read.h"
 #include "include/timers.h"
+#include <avr/sleep.h>
 #include "avrboard.h"
+#include "ext_interrupt.h"
 #include "uart_driver.h"
+#include "include/display.h"
+#include "lcd_async.h"
+#include "lcd_glyph.h"
+#include "lcd_screen.h"
+#include "clock.h"
+#include "dimmer.h"
+#include "event_loop.h"
+#include "ext_event.h"
 #include "rfid.h"
+#include "frame.h"
+#include "host_cmd.h"
+#include "reader_fsm.h"
 
-#define idle 0
+/**
+ * @brief The reader state machine, see reader_fsm.h.
+ */
+struct fsm reader = FSM_INIT( reader_table , reader_states , READER_EVENTS );
+
+/**
+ * @brief Set by the actions when a queue was full and the reader has to run
+ *        again.
+ */
+static uint8_t reader_retry = 0;
+
+/**
+ * @brief Called from the interrupts when the UID read made progress.
+ */
+void on_uid_read(void)
+{
+	event_post(EVENT_READER);
+}
+
+/**
+ * @brief Called from the receive interrupt for every byte from the server.
+ */
+void on_uart_rx(void)
+{
+	event_post(EVENT_UART_RX);
+}
+
+/**
+ * @brief Clock ticks from the card arriving until its UID was read, for the
+ *        last card.
+ */
+uint32_t card_read_ticks = 0;
 
+/**
+ * @brief Clock reading when the last card arrived.
+ */
+static uint32_t card_arrived;
+
+/**
+ * @brief Clock reading of the last rising edge of card present.
+ */
+static uint32_t card_edge;
+
+/**
+ * @brief Called from the external interrupts when an edge was queued.
+ */
+void on_ext_event(void)
+{
+	event_post(EVENT_CARD);
+}
 
-#define card_present  2
-#define activate_timer_int  3
-#define read_data  4
-#define send_command  5
-#define wait_on_data  6
-#define wait_on_card_removed 7
+/**
+ * @brief Turns an edge of card present (INT0) into a reader event.
+ *
+ * The edges come in the order they happened, also when the main loop was
+ * busy while the card was put on and taken away again.
+ */
+void on_card_edge(const struct ext_event *event)
+{
+	if (event->level)
+	{
+		card_edge = event->time;
+	}
+	fsm_dispatch(&reader, event->level ? READER_EV_CARD_IN : READER_EV_CARD_OUT);
+}
 
-char timerflag=0;
+/**
+ * @brief Shown after reset until the server writes to the display.
+ */
+LCD_SCREEN( screen_idle ,
+	"    Present card    " ,
+	"                    " ,
+	"                    " ,
+	"                    " );
 
+/**
+ * @brief Number of room configuration items the reader keeps.
+ */
+#define ROOM_CONFIG_ITEMS 8
 
+/**
+ * @brief Values of the room configuration items, set by the HACS server.
+ */
+uint16_t room_config[ ROOM_CONFIG_ITEMS ];
 
+/**
+ * @brief Sequence number of the last reader frame the server acknowledged.
+ */
+uint8_t host_ack_sequence = 0;
 
+/**
+ * @brief Parser for the frames sent by the HACS server.
+ */
+struct host_cmd_parser host_parser;
 
+/**
+ * @brief Writes the text of the frame into the given line of the LCD.
+ */
+void on_lcd_line(const uint8_t *payload, uint8_t length)
+{
+	if (length < 1)
+	{
+		return;
+	}
+	/* The parser terminated the payload, the text can be used in place.
+	 * Only the RAM copy is written, the interrupt updates the display.
+	 * Names may contain characters like æ, ø and å. */
+	lcd_glyph_write_line( payload[0], (const char *)payload + 1 );
+}
 
-void CheckReader()
+/**
+ * @brief Clears the LCD.
+ */
+void on_lcd_clear(const uint8_t *payload, uint8_t length)
 {
-	
-	static char state=0; 
-
-			
-		switch (state)
-		{
-			
-			
-		case idle : 
-			
-			
-		
-		
-			if ((CARD_PRES)==0x04) 
-			{
-			state = card_present;
-		
-
-			timerflag=0;
-			}
-			else 
-			{
-			state=idle;
-			
-			}break;
-		
-		case card_present:  
-	
-		
-			SPI_MasterTransmit(0x55);  
-			state= wait_on_data;
-			break;
-		
-		case wait_on_data : 
-		
-			if((DATA_READY)==0x08) 
-	
-			{
-				state = activate_timer_int; 
-			}
-			else
-			{
-				state = wait_on_data;
-				
-			}break;
-	
-		case activate_timer_int : 
-	
-			TIMSK |= (1<< OCIE0 );
-			state = read_data;
+	lcd_async_clear();
+}
 
-			break;
-	
-		case read_data :
-	
-			if((DATA_READY)==0x08)
-			{
-			
-				if (timerflag== 1) 
-				
-				{
-				
-				timerflag=0;
-				
-				SPI_MasterTransmit(0xF5);
-				FILL_BUFFER
-				
-				
-					IS_BUFFER_FULL
-					{
-					
-					TIMSK &= ~(1<<OCIE0); 
-				
-					state = wait_on_card_removed;
-					
-					}
-			 	}
-
-			 }
-
-			break;
-		case  wait_on_card_removed:
-	
-				
-			
-		
-	
-			
-			if (!(card_pres))
-			{
-				
-				SendString(BUFER);
-					
-				state=idle;
-				CLEAR_BUFFER_TRACKER;				
-    	
-			}
-										
-		
-			else 
-			{
-	
-			state=wait_on_card_removed	;
-		
-			
-							
-			}
-			break;			
-	
-	
-			default: 
-			state=idle;
-			break;
-	
+/**
+ * @brief Stores the value of one room configuration item, and sets the
+ *        dimmer if it is ::DIMMER_CONFIG_ITEM.
+ */
+void on_config_item(const uint8_t *payload, uint8_t length)
+{
+	if (length < 3 || payload[0] >= ROOM_CONFIG_ITEMS)
+	{
+		return;
+	}
+	room_config[ payload[0] ] = ((uint16_t)payload[1] << 8) | payload[2];
+	if (payload[0] == DIMMER_CONFIG_ITEM)
+	{
+		dimmer_config(room_config[ payload[0] ]);
 	}
 }
 
+/**
+ * @brief Remembers which reader frame the server acknowledged.
+ */
+void on_ack(const uint8_t *payload, uint8_t length)
+{
+	if (length < 1)
+	{
+		return;
+	}
+	host_ack_sequence = payload[0];
+}
 
+/**
+ * @brief Handlers for the frames sent by the HACS server.
+ */
+const struct host_cmd_handler host_handlers[] = {
+	{ FRAME_TYPE_LCD_LINE , on_lcd_line },
+	{ FRAME_TYPE_LCD_CLEAR , on_lcd_clear },
+	{ FRAME_TYPE_CONFIG_ITEM , on_config_item },
+	{ FRAME_TYPE_ACK , on_ack },
+};
 
 
-	
 
 
 
 
+/* Actions of the reader, see reader_fsm.h. The card present (INT0) and
+ * data ready (INT1) signals are handled as edge interrupts. INT0 queues
+ * both edges through ext_event.h, INT1 starts clocking in the UID directly,
+ * so between a card arriving and the UID being ready, the reader only has
+ * to start the read and look at the transaction status. */
 
+uint8_t reader_check_card_in(void)
+{
+	/* The edge may have been dispatched in another state already. */
+	if (CARD_PRES)
+	{
+		card_edge = clock_now();
+		return READER_EV_CARD_IN;
+	}
+	return FSM_NO_EVENT;
+}
 
+uint8_t reader_card_arrived(void)
+{
+	card_arrived = card_edge;
+	return READER_EV_POLL;
+}
 
-int main(void)
+uint8_t reader_start_read(void)
 {
-	USART_Init(0x40);  
-	SPI_MasterInit();
-	initTimer0(0); 
-	sei();
+	if (rfid_read_start())
+	{
+		return READER_EV_DONE;
+	}
+	reader_retry = 1;
+	return FSM_NO_EVENT;
+}
 
-;
-	
+uint8_t reader_read_end(void)
+{
+	card_read_ticks = clock_elapsed(card_arrived);
+	return FSM_NO_EVENT;
+}
 
-	while(1)
+uint8_t reader_check_card_out(void)
+{
+	return CARD_PRES ? FSM_NO_EVENT : READER_EV_CARD_OUT;
+}
+
+uint8_t reader_poll(void)
+{
+	return READER_EV_POLL;
+}
+
+uint8_t reader_send_uid(void)
+{
+	/* Only a complete UID is reported. */
+	if (rfid_read_status() != SPI_TXN_DONE
+	 || frame_send(FRAME_TYPE_CARD_UID, (uint8_t *)BUFFER, sizeof(BUFFER)))
 	{
-	CheckReader();
+		return READER_EV_DONE;
 	}
-	return 0;
+	reader_retry = 1;
+	return FSM_NO_EVENT;
 }
 
- 
+/**
+ * @brief Turns the card edges and the read status into reader events.
+ *
+ * Comes back without sleeping while an action waits for room in a queue.
+ */
+void on_reader_event(uint8_t events)
+{
+	uint8_t status = rfid_read_status();
 
-ISR (TIMER0_COMP_vect)  
+	reader_retry = 0;
+	ext_event_dispatch();
+	/* Done, or aborted by the watchdog. */
+	if (status == SPI_TXN_DONE || status == SPI_TXN_ABORTED)
+	{
+		fsm_dispatch(&reader, READER_EV_READ_END);
+	}
+	fsm_dispatch(&reader, READER_EV_POLL);
+	if (reader_retry)
+	{
+		event_post(EVENT_READER);
+	}
+}
+
+/**
+ * @brief Parses the frames sent by the HACS server.
+ *
+ * Comes back without sleeping if more bytes than ::HOST_CMD_BUDGET are
+ * waiting.
+ */
+void on_host_event(uint8_t events)
 {
-	
+	host_cmd_poll(&host_parser, host_handlers, sizeof(host_handlers) / sizeof(host_handlers[0]), HOST_CMD_BUDGET);
+	if (uart_rx_available())
+	{
+		event_post(EVENT_UART_RX);
+	}
+}
+
+/**
+ * @brief Handlers of the main loop.
+ */
+const struct event_handler event_handlers[] = {
+	{ EVENT_CARD | EVENT_READER , on_reader_event },
+	{ EVENT_UART_RX , on_host_event },
+};
+
+
+
 
-	timerflag=1;
 	
-} 
+
+
+
+
+
+
+
+int main(void)
+{
+	USART_Init( UART_UBRR , UART_USE_2X );
+	SPI_MasterInit();
+	spi_async_init();
+	rfid_read_event = on_uid_read;
+	uart_rx_event = on_uart_rx;
+	/* The display is initialized in the background, cards are accepted
+	 * while it waits for its power on time. */
+	lcd_async_power_on();
+	clock_init();
+	dimmer_init();
+	lcd_glyph_init();
+	lcd_screen_show( screen_idle );
+	host_cmd_init(&host_parser);
+	event_init();
+	/* Both edges of card present wake the reader up. */
+	ext_event_notify = on_ext_event;
+	ext_event_attach(EXT_EVENT_INT0, EXT_EVENT_CHANGE, on_card_edge);
+	fsm_start(&reader, READER_IDLE);
+	sei();
+	/* A card may be on the reader already, and bytes may have come in
+	 * before the hook was set. */
+	event_post(EVENT_CARD | EVENT_UART_RX);
+
+	/* Sleeps in idle mode between the events. Timer 1 keeps the display
+	 * and the clock running, the USART has to receive. */
+	while(1)
+	{
+	event_dispatch(event_wait(), event_handlers, sizeof(event_handlers) / sizeof(event_handlers[0]));
+	}
+	return 0;
+}
@@ -0,0 +1,128 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <stdlib.h>
+#include <include/baud.h>
+#include <include/uart_driver.c>
+
+/**
+ * @file
+ *
+ * @brief Test file for baud.h
+ *
+ * The first part of this test runs while compiling: for every baud rate in
+ * the tested set, the expected result of ::UART_BAUD_OK at 10 MHz is checked
+ * with \#if. If the calculation in baud.h changes, the build of this test
+ * fails with a message naming the baud rate.
+ *
+ * The second part runs on the board. It prints the table of all tested baud
+ * rates with their UBRR value, U2X setting and error over the UART at
+ * ::UART_BAUD. The table can be compared with the one in the documentation.
+ * To try one of the fast rates on the FT232 link, define UART_BAUD to it
+ * before baud.h is included and set the terminal program to the same rate.
+ */
+
+/* Standard rates that must be reachable at 10 MHz. */
+#if !UART_BAUD_OK( 9600UL ) || !UART_BAUD_OK( 19200UL ) || !UART_BAUD_OK( 38400UL )
+#error "9600, 19200 or 38400 baud not reachable"
+#endif
+#if !UART_BAUD_OK( 57600UL ) || !UART_BAUD_OK( 115200UL ) || !UART_BAUD_OK( 250000UL )
+#error "57600, 115200 or 250000 baud not reachable"
+#endif
+/* Fast rates that divide 10 MHz exactly. */
+#if !UART_BAUD_OK( 312500UL ) || !UART_BAUD_OK( 625000UL ) || !UART_BAUD_OK( 1250000UL )
+#error "312500, 625000 or 1250000 baud not reachable"
+#endif
+#if UART_UBRR_FOR_BAUD( 1250000UL ) != 0 || !UART_USE_2X_FOR( 1250000UL )
+#error "1250000 baud must use UBRR 0 with U2X"
+#endif
+/* Rates that do not divide 10 MHz and must be refused. */
+#if UART_BAUD_OK( 500000UL ) || UART_BAUD_OK( 1000000UL ) || UART_BAUD_OK( 2000000UL )
+#error "500000, 1000000 or 2000000 baud must be refused at 10 MHz"
+#endif
+/* The former magic value. */
+#if UART_UBRR_FOR_BAUD( 19200UL ) != 0x40 || !UART_USE_2X_FOR( 19200UL )
+#error "19200 baud must give UBRR 0x40 with U2X"
+#endif
+
+/**
+ * @brief One line of the printed table.
+ */
+struct baud_entry
+{
+	uint32_t baud;
+	uint16_t ubrr;
+	uint8_t use_2x;
+	uint16_t error;
+};
+
+/**
+ * @brief Declares one table line for a baud rate.
+ */
+#define BAUD_ENTRY( BAUD ) { BAUD , UART_UBRR_FOR_BAUD( BAUD ) , UART_USE_2X_FOR( BAUD ) , UART_ERROR_FOR_BAUD( BAUD ) }
+
+/**
+ * @brief The tested set of baud rates.
+ */
+static const struct baud_entry baud_table[] = {
+	BAUD_ENTRY( 9600UL ),
+	BAUD_ENTRY( 19200UL ),
+	BAUD_ENTRY( 38400UL ),
+	BAUD_ENTRY( 57600UL ),
+	BAUD_ENTRY( 115200UL ),
+	BAUD_ENTRY( 250000UL ),
+	BAUD_ENTRY( 312500UL ),
+	BAUD_ENTRY( 500000UL ),
+	BAUD_ENTRY( 625000UL ),
+	BAUD_ENTRY( 1000000UL ),
+	BAUD_ENTRY( 1250000UL ),
+};
+
+/**
+ * @brief Sends a number as text.
+ *
+ * @param value number that should be printed.
+ */
+void print_number(uint32_t value)
+{
+	char number[11];
+
+	ultoa(value, number, 10);
+	SendString(number);
+}
+
+int main(void)
+{
+	uint8_t i;
+
+	USART_Init( UART_UBRR , UART_USE_2X );
+	sei();
+
+	/* TEST 1
+	 *
+	 * This is tested: the run time values of the baud.h macros.
+	 *
+	 * Prints "baud ubrr u2x error/1000" for every entry of the tested set.
+	 * Lines with an error above UART_BAUD_TOL end with " refused".
+	 */
+	SendString("baud ubrr u2x error/1000\r\n");
+	for ( i = 0; i < sizeof(baud_table) / sizeof(baud_table[0]); i++ )
+	{
+		print_number( baud_table[i].baud );
+		SendString(" ");
+		print_number( baud_table[i].ubrr );
+		SendString(" ");
+		print_number( baud_table[i].use_2x );
+		SendString(" ");
+		print_number( baud_table[i].error );
+		if ( baud_table[i].error > UART_BAUD_TOL )
+		{
+			SendString(" refused");
+		}
+		SendString("\r\n");
+	}
+	uart_tx_flush();
+
+	while(1)
+	{
+	}
+}
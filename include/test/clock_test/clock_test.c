@@ -0,0 +1,128 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <string.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <include/timers.h>
+
+// The timing is calculated by lcd_timing.h.
+#include <include/display.h>
+#include <include/lcd_async.h>
+#include <include/clock.h>
+#include <include/avrboard.h>
+
+/**
+ * @file
+ *
+ * @brief Test file for clock.h
+ *
+ * Shows the results in the display:
+ *
+ * \code
+ * delay 1000xx
+ * back 0 0
+ * read xx
+ * \endcode
+ *
+ * "delay" is _delay_ms(100) measured with clock_elapsed_us(), in
+ * microseconds. "back" counts how often the clock went back, in main and
+ * in the timer 2 interrupt, while both read it for about 5 seconds. Both
+ * must be 0. "read" is the time one clock_now() takes, in ticks of 0.8 us.
+ */
+
+/**
+ * @brief Last clock reading of the timer 2 interrupt.
+ */
+volatile uint32_t isr_last = 0;
+
+/**
+ * @brief Times the clock went back in the timer 2 interrupt.
+ */
+volatile uint16_t isr_back = 0;
+
+/**
+ * @brief Shows a label and a number in a line of the display.
+ */
+void show_result(uint8_t line, uint8_t column, const char *label, uint32_t value)
+{
+	char text[ LCD_MAX_CHARS_LINE + 1 ];
+
+	strcpy( text , label );
+	ultoa( value , text + strlen( text ) , 10 );
+	lcd_async_write( line , column , text );
+}
+
+int main(void)
+{
+	uint32_t start;
+	uint32_t now;
+	uint32_t last;
+	uint16_t back = 0;
+	uint32_t reads;
+	uint16_t read_ticks;
+	uint16_t back_isr;
+
+	lcd_async_power_on();
+	clock_init();
+	sei();
+	lcd_async_flush();
+
+	/* TEST 1
+	 *
+	 * This is tested: clock_now() and clock_elapsed_us( uint32_t start ).
+	 */
+	start = clock_now();
+	_delay_ms(100);
+	show_result( 1 , 0 , "delay " , clock_elapsed_us( start ) );
+
+	/* TEST 2
+	 *
+	 * This is tested: the clock never goes back, also not across the
+	 * overflows of timer 1 and not when read in an interrupt. Timer 2
+	 * interrupts about every 26 us so the readings fall on all kinds of
+	 * counts.
+	 */
+	TCCR2 = _BV( WGM21 ) | _BV( CS21 );
+	OCR2 = 31;
+	TIMSK |= _BV( OCIE2 );
+	last = clock_now();
+	for ( reads = 0; reads < 200000; reads++ )
+	{
+		now = clock_now();
+		if ( now < last )
+		{
+			back++;
+		}
+		last = now;
+	}
+	TIMSK &= ~_BV( OCIE2 );
+	cli();
+	back_isr = isr_back;
+	sei();
+	show_result( 2 , 0 , "back " , back );
+	show_result( 2 , 8 , " " , back_isr );
+
+	/* TEST 3
+	 *
+	 * This is tested: the time a reading takes.
+	 */
+	cli();
+	start = clock_now();
+	clock_now();
+	read_ticks = clock_now() - start;
+	sei();
+	show_result( 3 , 0 , "read " , read_ticks / 2 );
+
+	while(1) {}
+}
+
+ISR(TIMER2_COMP_vect)
+{
+	uint32_t now = clock_now();
+
+	if ( now < isr_last )
+	{
+		isr_back++;
+	}
+	isr_last = now;
+}
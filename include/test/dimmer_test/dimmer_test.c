@@ -0,0 +1,106 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <string.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <include/timers.h>
+
+// The timing is calculated by lcd_timing.h.
+#include <include/display.h>
+#include <include/lcd_async.h>
+#include <include/clock.h>
+#include <include/dimmer.h>
+#include <include/avrboard.h>
+
+/**
+ * @file
+ *
+ * @brief Test file for dimmer.h
+ *
+ * Connect an LED with a resistor to PD7 (OC2). Shows the results in the
+ * display:
+ *
+ * \code
+ * up 520 down 520
+ * busy 0
+ * \endcode
+ *
+ * "up" and "down" are the times of a fade from off to full brightness and
+ * back in milliseconds, measured with clock.h. "busy" counts how often the
+ * overflow interrupt of timer 2 was on while the light stayed at one level
+ * for a second, it must be 0. Afterwards the LED fades up and down for ever,
+ * the brightness should look like it changes evenly.
+ */
+
+/**
+ * @brief Shows a label and a number in a line of the display.
+ */
+void show_result(uint8_t line, uint8_t column, const char *label, uint32_t value)
+{
+	char text[ LCD_MAX_CHARS_LINE + 1 ];
+
+	strcpy( text , label );
+	ultoa( value , text + strlen( text ) , 10 );
+	lcd_async_write( line , column , text );
+}
+
+/**
+ * @brief Fades to a level and measures the time it takes.
+ *
+ * @return time of the fade in milliseconds.
+ */
+uint32_t fade(uint8_t level)
+{
+	uint32_t start = clock_now();
+
+	dimmer_set( level , DIMMER_FADE_RATE );
+	while ( dimmer_fading() );
+	return clock_elapsed_us( start ) / 1000;
+}
+
+int main(void)
+{
+	uint16_t busy = 0;
+	uint16_t i;
+
+	lcd_async_power_on();
+	clock_init();
+	dimmer_init();
+	sei();
+	lcd_async_flush();
+
+	/* TEST 1
+	 *
+	 * This is tested: dimmer_set( uint8_t level , uint8_t rate ) fades in
+	 * about DIMMER_FADE_MS, both ways.
+	 */
+	show_result( 1 , 0 , "up " , fade( 255 ) );
+	show_result( 1 , 7 , " down " , fade( 0 ) );
+
+	/* TEST 2
+	 *
+	 * This is tested: a steady level costs no interrupts.
+	 */
+	dimmer_set( 128 , 0 );
+	for ( i = 0; i < 1000; i++ )
+	{
+		if ( TIMSK & _BV( TOIE2 ) )
+		{
+			busy++;
+		}
+		_delay_ms( 1 );
+	}
+	show_result( 2 , 0 , "busy " , busy );
+
+	/* TEST 3
+	 *
+	 * Look at the LED.
+	 */
+	while(1)
+	{
+		fade( 255 );
+		_delay_ms( 500 );
+		fade( 0 );
+		_delay_ms( 500 );
+	}
+}
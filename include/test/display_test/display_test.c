@@ -3,9 +3,8 @@
 #include <string.h>
 #include <include/timers.h>
 
-#define LCD_CLOCKDIVISION 8
-#define LCD_EXTRA_DIV 30 //20 caused errors
-#define LCD_TOP_DIV 60 //40 caused errors
+// The timing is calculated by lcd_timing.h: 8/25/58 at 10 MHz. By hand,
+// 8/30/60 worked and 8/20/40 caused errors, lcd_timing.h rejects the latter.
 #include <include/display.h>
 #include <include/avrboard.h>
 
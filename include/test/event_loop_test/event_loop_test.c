@@ -0,0 +1,135 @@
+#define F_CPU 10000000UL // 10 MHz
+#define SOFT_TIMER_TICKLESS
+#include <util/delay.h>
+#include <string.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <include/timers.h>
+
+// The timing is calculated by lcd_timing.h.
+#include <include/display.h>
+#include <include/lcd_async.h>
+#include <include/clock.h>
+#include <include/soft_timer.h>
+#include <include/event_loop.h>
+#include <include/avrboard.h>
+
+/**
+ * @file
+ *
+ * @brief Test file for event_loop.h
+ *
+ * Shows the results in the display:
+ *
+ * \code
+ * events 20 20
+ * wake xx
+ * idle 99
+ * late xx
+ * \endcode
+ *
+ * A tickless software timer posts ::EVENT_TIMER every 100 ms for 2 seconds.
+ * "events" counts the handler calls and the dispatches, both must be 20.
+ * "wake" is the number of wakeups, "idle" the share of the time spent
+ * asleep in percent and "late" the longest time from posting to the
+ * handler, in microseconds.
+ */
+
+/**
+ * @brief Posts the events.
+ */
+struct soft_timer tick;
+
+/**
+ * @brief Clock reading of the last post.
+ */
+volatile uint32_t posted;
+
+/**
+ * @brief Handler calls.
+ */
+uint16_t handled = 0;
+
+/**
+ * @brief Longest time from posting to the handler, in ticks.
+ */
+uint32_t latest = 0;
+
+/**
+ * @brief Shows a label and a number in a line of the display.
+ */
+void show_result(uint8_t line, uint8_t column, const char *label, uint32_t value)
+{
+	char text[ LCD_MAX_CHARS_LINE + 1 ];
+
+	strcpy( text , label );
+	ultoa( value , text + strlen( text ) , 10 );
+	lcd_async_write( line , column , text );
+}
+
+/**
+ * @brief Callback of the software timer, runs in the interrupt.
+ */
+void on_tick(void)
+{
+	posted = clock_now();
+	event_post( EVENT_TIMER );
+}
+
+/**
+ * @brief Handler of the timer event.
+ */
+void on_timer(uint8_t events)
+{
+	uint32_t late = clock_elapsed( posted );
+
+	if ( late > latest )
+	{
+		latest = late;
+	}
+	if ( ++handled == 20 )
+	{
+		soft_timer_stop( &tick );
+	}
+}
+
+/**
+ * @brief Handlers of the test.
+ */
+const struct event_handler handlers[] = {
+	{ EVENT_TIMER , on_timer },
+};
+
+int main(void)
+{
+	struct event_stats stats;
+
+	lcd_async_power_on();
+	clock_init();
+	soft_timer_init();
+	sei();
+	lcd_async_flush();
+
+	/* TEST 1
+	 *
+	 * This is tested: event_post( uint8_t events ), event_wait() and
+	 * event_dispatch(), and that the loop sleeps between the events.
+	 */
+	event_init();
+	tick.callback = on_tick;
+	soft_timer_start( &tick , SOFT_TIMER_MS( 100 ) , SOFT_TIMER_MS( 100 ) );
+	while ( handled < 20 )
+	{
+		event_dispatch( event_wait() , handlers , 1 );
+	}
+	event_get_stats( &stats );
+
+	show_result( 1 , 0 , "events " , handled );
+	show_result( 1 , 9 , " " , stats.dispatches );
+	show_result( 2 , 0 , "wake " , stats.wakeups );
+	show_result( 3 , 0 , "idle " ,
+		stats.idle_ticks * 100 / ( stats.idle_ticks + stats.busy_ticks ) );
+	show_result( 4 , 0 , "late " , CLOCK_TICKS_US( latest ) );
+
+	while(1) {}
+}
@@ -0,0 +1,159 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <string.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <include/timers.h>
+
+// The timing is calculated by lcd_timing.h.
+#include <include/display.h>
+#include <include/lcd_async.h>
+#include <include/clock.h>
+#include <include/ext_event.h>
+#include <include/avrboard.h>
+
+/**
+ * @file
+ *
+ * @brief Test file for ext_event.h
+ *
+ * Nothing has to be connected, PB2 (INT2) is switched as an output and the
+ * interrupt sees its own edges. Leave PB2 open. Shows the results in the
+ * display:
+ *
+ * \code
+ * up 5 high 5
+ * gap 10xx
+ * kept 7 lost 5
+ * down 5 off 0
+ * \endcode
+ *
+ * "up" counts the rising edges of 5 pulses, "high" how many of them were
+ * read as high in the interrupt. "gap" is the shortest time between two
+ * edges in microseconds, the pulses start 1 ms apart. "kept" and "lost" are
+ * the edges of 12 pulses that were queued without dispatching: the queue
+ * holds 7 and ::ext_event_overflows counts the rest. "down" counts falling
+ * edges and "off" the edges after ext_event_detach(), it must be 0.
+ */
+
+/**
+ * @brief Edges handed to on_edge().
+ */
+uint8_t edges = 0;
+
+/**
+ * @brief Edges that were read as high.
+ */
+uint8_t highs = 0;
+
+/**
+ * @brief Shortest time between two edges in ticks.
+ */
+uint32_t gap = 0xFFFFFFFF;
+
+/**
+ * @brief Time of the last edge.
+ */
+uint32_t last = 0;
+
+/**
+ * @brief Counts the edges and measures the time between them.
+ */
+void on_edge(const struct ext_event *event)
+{
+	if ( edges && event->time - last < gap )
+	{
+		gap = event->time - last;
+	}
+	last = event->time;
+	edges++;
+	highs += event->level;
+}
+
+/**
+ * @brief Starts a count.
+ */
+void reset(void)
+{
+	edges = 0;
+	highs = 0;
+	gap = 0xFFFFFFFF;
+}
+
+/**
+ * @brief Makes pulses of 100 us on PB2, 1 ms apart.
+ */
+void pulse(uint8_t count)
+{
+	while ( count-- )
+	{
+		PORTB |= _BV( PB2 );
+		_delay_us( 100 );
+		PORTB &= ~_BV( PB2 );
+		_delay_us( 900 );
+	}
+}
+
+/**
+ * @brief Shows a label and a number in a line of the display.
+ */
+void show_result(uint8_t line, uint8_t column, const char *label, uint32_t value)
+{
+	char text[ LCD_MAX_CHARS_LINE + 1 ];
+
+	strcpy( text , label );
+	ultoa( value , text + strlen( text ) , 10 );
+	lcd_async_write( line , column , text );
+}
+
+int main(void)
+{
+	PORTB &= ~_BV( PB2 );
+	DDRB |= _BV( PB2 );
+	lcd_async_power_on();
+	clock_init();
+	sei();
+	lcd_async_flush();
+
+	/* TEST 1
+	 *
+	 * This is tested: each edge is queued with the level of the pin and
+	 * its time, and handed to the handler of the line.
+	 */
+	ext_event_attach( EXT_EVENT_INT2 , EXT_EVENT_RISING , on_edge );
+	pulse( 5 );
+	ext_event_dispatch();
+	show_result( 1 , 0 , "up " , edges );
+	show_result( 1 , 4 , " high " , highs );
+	show_result( 2 , 0 , "gap " , CLOCK_TICKS_US( gap ) );
+
+	/* TEST 2
+	 *
+	 * This is tested: a full queue drops the newest edges and counts
+	 * them.
+	 */
+	reset();
+	ext_event_overflows = 0;
+	pulse( 12 );
+	ext_event_dispatch();
+	show_result( 3 , 0 , "kept " , edges );
+	show_result( 3 , 6 , " lost " , ext_event_overflows );
+
+	/* TEST 3
+	 *
+	 * This is tested: falling edges, and no edges after
+	 * ext_event_detach().
+	 */
+	reset();
+	ext_event_attach( EXT_EVENT_INT2 , EXT_EVENT_FALLING , on_edge );
+	pulse( 5 );
+	ext_event_dispatch();
+	show_result( 4 , 0 , "down " , edges - highs );
+	reset();
+	ext_event_detach( EXT_EVENT_INT2 );
+	pulse( 5 );
+	ext_event_dispatch();
+	show_result( 4 , 6 , " off " , edges );
+
+	while(1);
+}
@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+/**
+ * @file
+ *
+ * @brief Host test for fsm.h and the tables of reader_fsm.h
+ *
+ * Built and run on the development computer (make run), like
+ * host_cmd_test.c. The reader tables are the ones statemachine.c uses,
+ * only the actions are replaced by functions that work on a simulated card,
+ * UID read and queue.
+ *
+ * The test prints one line per test and "FAILED" if a check did not work.
+ * The exit code is the number of failed tests.
+ */
+
+#include <include/fsm.h>
+#include <include/reader_fsm.h>
+
+/**
+ * @brief The simulated reader.
+ */
+static uint8_t card;       /**< a card is on the reader */
+static uint8_t read_ended; /**< the UID read is done or aborted */
+static uint8_t queue_full; /**< the SPI queue and transmit buffer are full */
+static uint32_t reads;     /**< reads started */
+static uint32_t sent;      /**< UIDs sent */
+static uint8_t retry;      /**< an action found the queue full */
+static uint32_t fed;       /**< events fed to the reader */
+
+uint8_t reader_check_card_in(void)
+{
+	return card ? READER_EV_CARD_IN : FSM_NO_EVENT;
+}
+
+uint8_t reader_card_arrived(void)
+{
+	return READER_EV_POLL;
+}
+
+uint8_t reader_start_read(void)
+{
+	if ( queue_full )
+	{
+		retry = 1;
+		return FSM_NO_EVENT;
+	}
+	read_ended = 0;
+	reads++;
+	return READER_EV_DONE;
+}
+
+uint8_t reader_read_end(void)
+{
+	return FSM_NO_EVENT;
+}
+
+uint8_t reader_check_card_out(void)
+{
+	return card ? FSM_NO_EVENT : READER_EV_CARD_OUT;
+}
+
+uint8_t reader_poll(void)
+{
+	return READER_EV_POLL;
+}
+
+uint8_t reader_send_uid(void)
+{
+	if ( queue_full )
+	{
+		retry = 1;
+		return FSM_NO_EVENT;
+	}
+	sent++;
+	return READER_EV_DONE;
+}
+
+static struct fsm reader = FSM_INIT( reader_table , reader_states , READER_EVENTS );
+
+/**
+ * @brief Feeds the events like on_reader_event() of statemachine.c.
+ *
+ * The card event stands for the last edge queued by ext_event.h.
+ */
+static void reader_step(void)
+{
+	retry = 0;
+	fsm_dispatch( &reader , card ? READER_EV_CARD_IN : READER_EV_CARD_OUT );
+	if ( read_ended )
+	{
+		fsm_dispatch( &reader , READER_EV_READ_END );
+		fed++;
+	}
+	fsm_dispatch( &reader , READER_EV_POLL );
+	fed += 2;
+}
+
+/**
+ * @brief Times each cell of the reader table was taken.
+ */
+static uint32_t cell_hits[ READER_STATES ][ READER_EVENTS ];
+
+static void count_cell(uint8_t state, uint8_t event, uint8_t next)
+{
+	cell_hits[ state ][ event ]++;
+}
+
+/**
+ * @brief Order of the actions of the small machine, as letters.
+ */
+static char order[ 32 ];
+
+static void note(char c)
+{
+	order[ strlen( order ) ] = c;
+}
+
+static uint8_t enter_a(void) { note( 'a' ); return FSM_NO_EVENT; }
+static uint8_t leave_a(void) { note( 'A' ); return FSM_NO_EVENT; }
+static uint8_t enter_b(void) { note( 'b' ); return FSM_NO_EVENT; }
+static uint8_t leave_b(void) { note( 'B' ); return FSM_NO_EVENT; }
+static uint8_t go(void) { note( 't' ); return FSM_NO_EVENT; }
+static uint8_t go_on(void) { note( 't' ); return 0; }
+
+static void trace_order(uint8_t state, uint8_t event, uint8_t next)
+{
+	note( '0' + state );
+}
+
+/**
+ * @brief Two states, event 0 switches, event 1 is internal in state 0 and
+ *        chains event 0 in state 1.
+ */
+static const struct fsm_transition small_table[ 2 ][ 2 ] PROGMEM = {
+	[ 0 ][ 0 ] = FSM_GO( 1 , go ),
+	[ 0 ][ 1 ] = FSM_GO( 0 , go ),
+	[ 1 ][ 0 ] = FSM_GO( 0 , go ),
+	[ 1 ][ 1 ] = FSM_GO( 1 , go_on ),
+};
+
+static const struct fsm_state small_states[ 2 ] PROGMEM = {
+	{ enter_a , leave_a },
+	{ enter_b , leave_b },
+};
+
+static int report(const char *name, int ok)
+{
+	printf( "%-40s %s\n" , name , ok ? "ok" : "FAILED" );
+	return !ok;
+}
+
+int main(void)
+{
+	struct fsm small = FSM_INIT( small_table , small_states , 2 );
+	int failed = 0;
+	int ok;
+	uint8_t state;
+	uint8_t event;
+	uint32_t i;
+	uint32_t covered;
+	uint32_t cells;
+	clock_t start;
+	double seconds;
+
+	/* TEST 1
+	 *
+	 * This is tested: the order of the actions. A transition to another
+	 * state runs exit, transition action and entry, an internal one only
+	 * the transition action. An event returned by an action is dispatched
+	 * right away, an ignored event changes nothing.
+	 */
+	small.trace = trace_order;
+	fsm_start( &small , 0 );
+	fsm_dispatch( &small , 1 );
+	fsm_dispatch( &small , 0 );
+	fsm_dispatch( &small , 1 );
+	printf( "action order: %s\n" , order );
+	failed += report( "entry, exit and transition actions" ,
+		strcmp( order , "a0t0Atb1t1Bta" ) == 0 && small.state == 0 );
+
+	/* TEST 2
+	 *
+	 * This is tested: the reader flow with a card that stays until the
+	 * read ended, and with full queues.
+	 */
+	fsm_start( &reader , READER_IDLE );
+	ok = reader.state == READER_IDLE;
+	card = 1;
+	queue_full = 1;
+	reader_step();
+	ok = ok && reader.state == READER_START && retry && reads == 0;
+	queue_full = 0;
+	reader_step();
+	ok = ok && reader.state == READER_READING && !retry && reads == 1;
+	read_ended = 1;
+	reader_step();
+	ok = ok && reader.state == READER_REMOVE;
+	card = 0;
+	queue_full = 1;
+	reader_step();
+	ok = ok && reader.state == READER_SEND && retry && sent == 0;
+	queue_full = 0;
+	reader_step();
+	ok = ok && reader.state == READER_IDLE && sent == 1;
+	failed += report( "reader flow" , ok );
+
+	/* TEST 3
+	 *
+	 * This is tested: a card that is gone when the read ends and a card
+	 * that is back before the UID was sent. The entry actions look at the
+	 * pin, so both need only one step.
+	 */
+	card = 1;
+	reader_step();
+	card = 0;
+	read_ended = 1;
+	reader_step();
+	ok = reader.state == READER_IDLE && reads == 2 && sent == 2;
+	card = 1;
+	reader_step();
+	read_ended = 1;
+	reader_step();
+	card = 0;
+	queue_full = 1;
+	reader_step();
+	card = 1;
+	reader_step();
+	ok = ok && reader.state == READER_SEND && reads == 3 && sent == 2;
+	queue_full = 0;
+	reader_step();
+	ok = ok && reader.state == READER_READING && reads == 4 && sent == 3;
+	failed += report( "card gone or back early" , ok );
+
+	/* TEST 4
+	 *
+	 * This is tested: every transition of the reader table is taken by
+	 * random inputs, and the reader never sends more UIDs than it read.
+	 */
+	srand( 1 );
+	reader.trace = count_cell;
+	fsm_start( &reader , READER_IDLE );
+	reads = 0;
+	sent = 0;
+	for ( i = 0; i < 100000; i++ )
+	{
+		card = rand() % 2;
+		read_ended = rand() % 2;
+		queue_full = rand() % 4 == 0;
+		reader_step();
+	}
+	covered = 0;
+	cells = 0;
+	for ( state = 0; state < READER_STATES; state++ )
+	{
+		for ( event = 0; event < READER_EVENTS; event++ )
+		{
+			if ( pgm_read_byte( &reader_table[ state ][ event ].next ) )
+			{
+				cells++;
+				covered += cell_hits[ state ][ event ] != 0;
+			}
+		}
+	}
+	printf( "coverage: %u of %u transitions, %u reads, %u sent\n" ,
+		(unsigned)covered , (unsigned)cells , (unsigned)reads , (unsigned)sent );
+	failed += report( "transition coverage" , covered == cells && sent <= reads );
+
+	/* TEST 5
+	 *
+	 * Throughput of fsm_dispatch() on the development computer. Only
+	 * useful to compare changes of fsm.h with each other.
+	 */
+	reader.trace = 0;
+	fed = 0;
+	start = clock();
+	for ( i = 0; i < 10000000; i++ )
+	{
+		card = ( i >> 2 ) & 1;
+		read_ended = ( i >> 1 ) & 1;
+		queue_full = 0;
+		reader_step();
+	}
+	seconds = (double)( clock() - start ) / CLOCKS_PER_SEC;
+	printf( "throughput: %lu events in %.3f s, %.1f million events/s\n" ,
+		(unsigned long)fed , seconds , seconds > 0 ? fed / seconds / 1e6 : 0.0 );
+	failed += report( "throughput run" , reads > 0 );
+
+	return failed;
+}
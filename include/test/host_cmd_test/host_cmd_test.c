@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+/**
+ * @file
+ *
+ * @brief Host test for host_cmd.h
+ *
+ * Unlike the other tests, this one is built and run on the development
+ * computer (make run). The parser only depends on the UART driver through
+ * uart_rx_read() and uart_tx_write(), both are replaced here.
+ *
+ * The test prints one line per test and "FAILED" if a check did not work.
+ * The exit code is the number of failed tests.
+ */
+
+/**
+ * @brief Byte stream the replaced uart_rx_read() reads from.
+ */
+static const uint8_t *rx_stream;
+
+/**
+ * @brief Bytes left in ::rx_stream.
+ */
+static size_t rx_left;
+
+uint8_t uart_rx_read(uint8_t *data)
+{
+	if ( rx_left == 0 )
+	{
+		return 0;
+	}
+	*data = *rx_stream++;
+	rx_left--;
+	return 1;
+}
+
+uint8_t uart_tx_write(const uint8_t *data, uint8_t length)
+{
+	(void)data;
+	return length;
+}
+
+#include <include/host_cmd.h>
+
+/**
+ * @brief Biggest test stream.
+ */
+#define STREAM_SIZE ( 1L << 22 )
+
+static uint8_t stream[ STREAM_SIZE ];
+
+/**
+ * @brief Payload checksum of all frames written with put_frame().
+ */
+static uint32_t sent_sum;
+
+/**
+ * @brief Payload checksum of all frames seen by the handler.
+ */
+static uint32_t received_sum;
+
+/**
+ * @brief Frames seen by the handler.
+ */
+static uint32_t received_frames;
+
+static void on_frame(const uint8_t *payload, uint8_t length)
+{
+	uint8_t i;
+
+	for ( i = 0; i < length; i++ )
+	{
+		received_sum = received_sum * 31 + payload[i];
+	}
+	/* The parser must terminate the payload. */
+	if ( payload[ length ] != 0 )
+	{
+		received_sum ^= 0xDEADBEEF;
+	}
+	received_frames++;
+}
+
+static const struct host_cmd_handler handlers[] = {
+	{ FRAME_TYPE_LCD_LINE , on_frame },
+	{ FRAME_TYPE_LCD_CLEAR , on_frame },
+	{ FRAME_TYPE_CONFIG_ITEM , on_frame },
+	{ FRAME_TYPE_ACK , on_frame },
+};
+
+/**
+ * @brief Writes a valid random frame to \b out.
+ *
+ * @return number of bytes written.
+ */
+static size_t put_frame(uint8_t *out)
+{
+	uint8_t length = rand() % ( FRAME_MAX_PAYLOAD + 1 );
+	uint16_t crc = 0xFFFF;
+	size_t i;
+
+	out[0] = FRAME_SYNC;
+	out[1] = handlers[ rand() % 4 ].type;
+	out[2] = length;
+	out[3] = rand();
+	for ( i = 0; i < length; i++ )
+	{
+		out[ 4 + i ] = rand();
+		sent_sum = sent_sum * 31 + out[ 4 + i ];
+	}
+	for ( i = 1; i < length + 4u; i++ )
+	{
+		crc = crc16_update( crc , out[i] );
+	}
+	out[ length + 4 ] = crc >> 8;
+	out[ length + 5 ] = crc & 0xFF;
+	return length + FRAME_OVERHEAD;
+}
+
+/**
+ * @brief Feeds a stream through host_cmd_poll() in small budgets, the way
+ *        the main loop does.
+ */
+static void parse(struct host_cmd_parser *parser, const uint8_t *data, size_t length)
+{
+	rx_stream = data;
+	rx_left = length;
+	while ( rx_left )
+	{
+		host_cmd_poll( parser , handlers , 4 , HOST_CMD_BUDGET );
+	}
+}
+
+static int report(const char *name, int ok)
+{
+	printf( "%-40s %s\n" , name , ok ? "ok" : "FAILED" );
+	return !ok;
+}
+
+int main(void)
+{
+	struct host_cmd_parser parser;
+	size_t length;
+	size_t i;
+	uint32_t frames;
+	int failed = 0;
+	clock_t start;
+	double seconds;
+
+	srand( 1 );
+
+	/* TEST 1
+	 *
+	 * Valid frames with noise in between that contains no sync byte. Every
+	 * frame must arrive, with the same payload.
+	 */
+	host_cmd_init( &parser );
+	sent_sum = received_sum = received_frames = 0;
+	length = 0;
+	frames = 0;
+	while ( length < 100000 )
+	{
+		length += put_frame( stream + length );
+		frames++;
+		for ( i = rand() % 4; i > 0; i-- )
+		{
+			uint8_t noise = rand();
+
+			stream[ length++ ] = noise == FRAME_SYNC ? 0 : noise;
+		}
+	}
+	parse( &parser , stream , length );
+	failed += report( "frames with noise" ,
+		received_frames == frames && received_sum == sent_sum
+		&& parser.crc_errors == 0 && parser.frames == frames );
+
+	/* TEST 2
+	 *
+	 * Every frame gets one flipped bit in the payload or CRC. No frame may
+	 * arrive, every one must be counted as CRC error.
+	 */
+	host_cmd_init( &parser );
+	received_frames = 0;
+	length = 0;
+	frames = 0;
+	while ( length < 100000 )
+	{
+		size_t frame_length = put_frame( stream + length );
+
+		if ( frame_length == FRAME_OVERHEAD )
+		{
+			/* No payload, flip a bit in the CRC. */
+			stream[ length + 4 + rand() % 2 ] ^= 1 << ( rand() % 8 );
+		}
+		else
+		{
+			stream[ length + 4 + rand() % ( frame_length - 4 ) ] ^= 1 << ( rand() % 8 );
+		}
+		length += frame_length;
+		frames++;
+	}
+	parse( &parser , stream , length );
+	failed += report( "corrupted frames are dropped" ,
+		received_frames == 0 && parser.crc_errors == frames );
+
+	/* TEST 3
+	 *
+	 * Too long frames are dropped and the parser finds the next frame.
+	 */
+	host_cmd_init( &parser );
+	received_frames = 0;
+	stream[0] = FRAME_SYNC;
+	stream[1] = FRAME_TYPE_LCD_LINE;
+	stream[2] = FRAME_MAX_PAYLOAD + 1;
+	length = 3 + put_frame( stream + 3 );
+	parse( &parser , stream , length );
+	failed += report( "too long frame is dropped" ,
+		received_frames == 1 && parser.length_errors == 1 );
+
+	/* TEST 4
+	 *
+	 * Fuzzing: random bytes. Nothing may crash and the counters must add
+	 * up. Frames found by chance are fine (1 in 65536 CRCs match).
+	 */
+	host_cmd_init( &parser );
+	for ( i = 0; i < STREAM_SIZE; i++ )
+	{
+		stream[i] = rand();
+	}
+	parse( &parser , stream , STREAM_SIZE );
+	printf( "random bytes: %u frames, %u crc errors, %u length errors, %u unknown\n" ,
+		parser.frames , parser.crc_errors , parser.length_errors , parser.unknown_types );
+	failed += report( "random bytes" , parser.state <= HOST_CMD_CRC_LOW );
+
+	/* TEST 5
+	 *
+	 * Throughput of the parser on the development computer. Only useful to
+	 * compare changes of the parser with each other.
+	 */
+	host_cmd_init( &parser );
+	received_frames = 0;
+	length = 0;
+	while ( length < STREAM_SIZE - FRAME_MAX_PAYLOAD - FRAME_OVERHEAD )
+	{
+		length += put_frame( stream + length );
+	}
+	start = clock();
+	parse( &parser , stream , length );
+	seconds = (double)( clock() - start ) / CLOCKS_PER_SEC;
+	printf( "throughput: %lu bytes, %u frames in %.3f s, %.1f MB/s\n" ,
+		(unsigned long)length , (unsigned)received_frames , seconds ,
+		seconds > 0 ? length / seconds / 1e6 : 0.0 );
+	/* The frame counter of the parser is 16 bit wide and wraps. */
+	failed += report( "throughput run" , (uint16_t)received_frames == parser.frames );
+
+	return failed;
+}
@@ -0,0 +1,189 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <string.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <include/timers.h>
+
+#define LCD_CLOCKDIVISION 8
+#define LCD_EXTRA_DIV 30
+#define LCD_TOP_DIV 60
+#include <include/display.h>
+#include <include/lcd_async.h>
+#include <include/lcd_marquee.h>
+#include <include/avrboard.h>
+
+/**
+ * @file
+ *
+ * @brief Test file for lcd_async.h
+ *
+ * Writes the same screen once with lcd_write_line( char *line_text ) and once
+ * with lcd_async_write_line( uint8_t line , const char *text ) and shows the
+ * times on the display:
+ *
+ * \code
+ * sync 8x
+ * call 2xx async 8x
+ * \endcode
+ *
+ * "sync" and "async" are the times until the whole screen is on the display,
+ * in timer 2 counts of 102.4 microseconds. Both should be about the same,
+ * around 8 ms with the timing set below.
+ * "call" is the time the main program spent in the four
+ * lcd_async_write_line() calls, in timer 1 counts of 0.8 microseconds.
+ *
+ * The LED lights up if lcd_async_busy() reports the right state.
+ *
+ * Then a PIN entry is shown in line 3 and the bytes sent to the display for
+ * each step are shown in line 4, e.g. "bus 16 2 1 1 1". The first number is
+ * the "Enter PIN: ____" line, the others are the four digits.
+ *
+ * At last a message scrolls through lines 1 and 3 for 40 steps. Line 4 then
+ * shows the bytes sent for all steps, "steps 40" means one byte per step.
+ */
+
+/**
+ * @brief Screen written in both tests.
+ */
+static const char *screen[4] = {
+	"Line 1 ------------>",
+	"Line 2 ------------>",
+	"Line 3 ------------>",
+	"Line 4 ------------>"
+};
+
+/**
+ * @brief Timer 2 counts in steps of 1024 CPU cycles.
+ */
+#define TIMER2_START ( TCCR2 = _BV( CS22 ) | _BV( CS21 ) | _BV( CS20 ) )
+
+int main(void)
+{
+	uint8_t line;
+	uint8_t time_sync;
+	uint8_t time_async;
+	uint16_t time_call;
+	uint8_t busy_while_sending;
+	uint8_t digit;
+	char number[6];
+	char bus[LCD_MAX_CHARS_LINE + 1];
+
+	LED_ACTIVATE;
+	LED_OFF;
+
+	/* TEST 1
+	 *
+	 * This is tested: the blocking lcd_write_line( char *line_text ).
+	 *
+	 * The screen should be filled with four lines.
+	 */
+	LCD_INIT;
+	TIMER2_START;
+	TCNT2 = 0;
+	for ( line = 1; line <= 4; line++ )
+	{
+		LCD_JUMP_LINE_START( line );
+		lcd_write_line( (char *)screen[ line - 1 ] );
+	}
+	time_sync = TCNT2;
+
+	_delay_ms(3000);
+
+	/* TEST 2
+	 *
+	 * This is tested: lcd_async_init(), lcd_async_write_line( uint8_t line ,
+	 * const char *text ), lcd_async_flush() and lcd_async_busy().
+	 *
+	 * The screen is cleared with the blocking macro first, so the async
+	 * driver has to write all lines again. The same four lines should appear.
+	 */
+	LCD_CLEAR;
+	lcd_async_init();
+	sei();
+
+	TCNT2 = 0;
+	time_call = TCNT1;
+	for ( line = 1; line <= 4; line++ )
+	{
+		lcd_async_write_line( line , screen[ line - 1 ] );
+	}
+	time_call = TCNT1 - time_call;
+	busy_while_sending = lcd_async_busy();
+	lcd_async_flush();
+	time_async = TCNT2;
+
+	if ( busy_while_sending && !lcd_async_busy() )
+	{
+		LED_ON;
+	}
+
+	_delay_ms(3000);
+
+	/* TEST 3
+	 *
+	 * This is tested: lcd_async_clear() and lcd_async_write( uint8_t line ,
+	 * uint8_t column , const char *text ).
+	 *
+	 * The screen is cleared and the results are shown in lines 1 and 2.
+	 */
+	lcd_async_clear();
+	lcd_async_write( 1 , 0 , "sync" );
+	lcd_async_write( 1 , 5 , utoa( time_sync , number , 10 ) );
+	lcd_async_write( 2 , 0 , "call" );
+	lcd_async_write( 2 , 5 , utoa( time_call , number , 10 ) );
+	lcd_async_write( 2 , 9 , "async" );
+	lcd_async_write( 2 , 15 , utoa( time_async , number , 10 ) );
+	lcd_async_flush();
+
+	/* TEST 4
+	 *
+	 * This is tested: only changed cells are sent.
+	 *
+	 * A PIN entry screen is written and the digits are replaced by stars one
+	 * by one. Each star should cost 2 bytes on the bus, an address command
+	 * and the character, or only 1 if the address counter is already there.
+	 */
+	lcd_async_transfers = 0;
+	lcd_async_write_line( 3 , "Enter PIN: ____" );
+	lcd_async_flush();
+	strcpy( bus , "bus " );
+	utoa( lcd_async_transfers , bus + strlen( bus ) , 10 );
+	for ( digit = 0; digit < 4; digit++ )
+	{
+		_delay_ms(500);
+		lcd_async_transfers = 0;
+		lcd_async_write( 3 , 11 + digit , "*" );
+		lcd_async_flush();
+		strcat( bus , " " );
+		utoa( lcd_async_transfers , bus + strlen( bus ) , 10 );
+	}
+	lcd_async_write_line( 4 , bus );
+
+	_delay_ms(5000);
+
+	/* TEST 5
+	 *
+	 * This is tested: lcd_marquee_start( uint8_t line , const char *text )
+	 * and lcd_marquee_stop().
+	 *
+	 * The message scrolls to the left, its end comes out of line 3 into
+	 * line 1. Lines 2 and 4 scroll along. After one round the display is
+	 * back where it started.
+	 */
+	lcd_async_clear();
+	lcd_async_flush();
+	lcd_marquee_interval = 20;
+	lcd_marquee_start( 1 , "This message is longer than a line." );
+	lcd_async_flush();
+	lcd_async_transfers = 0;
+	while ( lcd_marquee_offset != LCD_MARQUEE_CELLS - 1 );
+	while ( lcd_marquee_offset != 0 );
+	lcd_async_flush();
+	strcpy( bus , "steps " );
+	utoa( lcd_async_transfers , bus + strlen( bus ) , 10 );
+	lcd_marquee_stop();
+	lcd_async_write_line( 4 , bus );
+
+	while(1) {}
+}
@@ -0,0 +1,154 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <string.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <include/timers.h>
+
+// The timing is calculated by lcd_timing.h.
+#include <include/display.h>
+#include <include/lcd_async.h>
+#include <include/avrboard.h>
+
+/**
+ * @file
+ *
+ * @brief Measures how long the display keeps the reader from taking a card
+ *        after reset.
+ *
+ * The reader takes a card as soon as main() reaches its loop. Before the
+ * loop, the display is initialized. This test measures that time for both
+ * ways of doing it and shows the results in microseconds:
+ *
+ * \code
+ * power_on 1x
+ * ready 276xx
+ * init 26xxx
+ * \endcode
+ *
+ * "power_on" is the time spent in lcd_async_power_on(), the time to the
+ * first card with the background initialisation. "ready" is the time until
+ * lcd_async_ready() returns 1, the display initializes meanwhile. "init" is
+ * the time spent in ::LCD_INIT and lcd_async_init(), the time to the first
+ * card before.
+ *
+ * lcd_async_power_on() is tested first, right after reset, like in the
+ * reader. Line 4 shows "Hello" if text written before the display was ready
+ * came through.
+ */
+
+/**
+ * @brief Timer 2 counts in steps of 1024 CPU cycles, 102.4 microseconds.
+ */
+#define TIMER2_START ( TCCR2 = _BV( CS22 ) | _BV( CS21 ) | _BV( CS20 ) )
+
+/**
+ * @brief Converts timer 2 counts to microseconds.
+ */
+#define TIMER2_US( COUNTS ) ( (uint32_t)( COUNTS ) * 1024 / ( F_CPU / 1000000UL ) )
+
+/**
+ * @brief Overflows of timer 2 since timer2_reset().
+ */
+volatile uint8_t timer2_overflows;
+
+/**
+ * @brief Starts the time measurement at 0.
+ */
+void timer2_reset(void)
+{
+	cli();
+	TCNT2 = 0;
+	TIFR = _BV( TOV2 );
+	timer2_overflows = 0;
+	sei();
+}
+
+/**
+ * @brief Time since timer2_reset() in timer 2 counts.
+ */
+uint16_t timer2_read(void)
+{
+	uint8_t counts;
+	uint8_t overflows;
+
+	cli();
+	counts = TCNT2;
+	overflows = timer2_overflows;
+	/* An overflow that came after the interrupts were disabled. */
+	if ( ( TIFR & _BV( TOV2 ) ) && counts < 0x80 )
+	{
+		overflows++;
+	}
+	sei();
+	return ( (uint16_t)overflows << 8 ) | counts;
+}
+
+/**
+ * @brief Shows a label and a number in a line of the display.
+ *
+ * @param line line number from 1 to 4.
+ * @param label text in front of the number.
+ * @param value number that should be shown.
+ */
+void show_result(uint8_t line, char *label, uint32_t value)
+{
+	char text[ LCD_MAX_CHARS_LINE + 1 ];
+
+	strcpy( text , label );
+	ultoa( value , text + strlen( text ) , 10 );
+	lcd_async_write_line( line , text );
+}
+
+int main(void)
+{
+	uint16_t counts_power_on;
+	uint16_t counts_ready;
+	uint16_t counts_init;
+
+	LED_ACTIVATE;
+	LED_OFF;
+
+	TIMSK |= _BV( TOIE2 );
+	TIMER2_START;
+
+	/* TEST 1
+	 *
+	 * This is tested: lcd_async_power_on().
+	 *
+	 * The call returns at once, the display gets ready about 28 ms later.
+	 */
+	timer2_reset();
+	lcd_async_power_on();
+	counts_power_on = timer2_read();
+	lcd_async_write_line( 4 , "Hello" );
+	while ( !lcd_async_ready() );
+	counts_ready = timer2_read();
+	lcd_async_flush();
+
+	_delay_ms(2000);
+
+	/* TEST 2
+	 *
+	 * This is tested: ::LCD_INIT and lcd_async_init(), the way before.
+	 *
+	 * Timer 1 is taken over by display.h for ::LCD_INIT, the background
+	 * transfer is idle after lcd_async_flush().
+	 */
+	timer2_reset();
+	LCD_INIT;
+	lcd_async_init();
+	counts_init = timer2_read();
+
+	show_result( 1 , "power_on " , TIMER2_US( counts_power_on ) );
+	show_result( 2 , "ready " , TIMER2_US( counts_ready ) );
+	show_result( 3 , "init " , TIMER2_US( counts_init ) );
+	lcd_async_flush();
+
+	while(1) {}
+}
+
+ISR(TIMER2_OVF_vect)
+{
+	timer2_overflows++;
+}
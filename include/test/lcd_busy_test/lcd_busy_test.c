@@ -0,0 +1,115 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <string.h>
+#include <stdlib.h>
+#include <include/timers.h>
+
+#define LCD_CLOCKDIVISION 8
+#define LCD_EXTRA_DIV 30
+#define LCD_TOP_DIV 60
+#include <include/display.h>
+#include <include/avrboard.h>
+
+/**
+ * @file
+ *
+ * @brief Measures the LCD latency with fixed timings and with the busy flag.
+ *
+ * The mode is chosen when building: "make" uses the fixed timings of
+ * display_test, "make TEST_DEFS=-DLCD_RW=1" the busy flag mode with R/W on
+ * PA1. Both builds show their results in line 1 and 2 of the display:
+ *
+ * \code
+ * char 96
+ * clear 2xxx
+ * \endcode
+ *
+ * "char" is the time per character in microseconds, the mean of 20
+ * characters written with lcd_write_line( char *line_text ). "clear" is the
+ * time from the clear command until the display takes the next byte, in
+ * microseconds. Timer 2 runs with a clock division of 256 for both.
+ *
+ * The LED lights up in busy flag mode if the address counter read back after
+ * the line has the expected value, so reading works at all.
+ */
+
+/**
+ * @brief Timer 2 counts in steps of 256 CPU cycles, 25.6 microseconds.
+ */
+#define TIMER2_START ( TCCR2 = _BV( CS22 ) | _BV( CS21 ) )
+
+/**
+ * @brief Converts timer 2 counts to microseconds.
+ */
+#define TIMER2_US( COUNTS ) ( (uint32_t)( COUNTS ) * 256 / ( F_CPU / 1000000UL ) )
+
+/**
+ * @brief Shows a label and a number in a line of the display.
+ *
+ * @param line line number from 1 to 4.
+ * @param label text in front of the number.
+ * @param value number that should be shown.
+ */
+void show_result(uint8_t line, char *label, uint16_t value)
+{
+	char text[ LCD_MAX_CHARS_LINE + 1 ];
+
+	strcpy( text , label );
+	utoa( value , text + strlen( text ) , 10 );
+	LCD_JUMP_LINE_START( line );
+	lcd_write_line( text );
+}
+
+int main(void)
+{
+	uint8_t counts_line;
+	uint8_t counts_clear;
+	uint8_t address;
+
+	LED_ACTIVATE;
+	LED_OFF;
+
+	LCD_INIT;
+	TIMER2_START;
+
+	/* TEST 1
+	 *
+	 * This is tested: time per character.
+	 *
+	 * A full line is written to line 3.
+	 */
+	LCD_JUMP_LINE_START( 3 );
+	lcd_wait_ready();
+	TCNT2 = 0;
+	lcd_write_line( "01234567890123456789" );
+	lcd_wait_ready();
+	counts_line = TCNT2;
+
+	/* Line 3 starts at DDRAM address 0x14, so the counter is at 0x28. */
+	address = lcd_read_status() & 0x7F;
+#ifdef LCD_RW
+	if ( address == 0x14 + LCD_MAX_CHARS_LINE )
+	{
+		LED_ON;
+	}
+#endif
+
+	_delay_ms(2000);
+
+	/* TEST 2
+	 *
+	 * This is tested: LCD_CLEAR.
+	 *
+	 * The display should be empty afterwards.
+	 */
+	TCNT2 = 0;
+	LCD_CLEAR;
+	lcd_wait_ready();
+	counts_clear = TCNT2;
+
+	show_result( 1 , "char " , TIMER2_US( counts_line ) / LCD_MAX_CHARS_LINE );
+	show_result( 2 , "clear " , TIMER2_US( counts_clear ) );
+	show_result( 4 , "AC " , address );
+
+	while(1) {}
+}
@@ -0,0 +1,112 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <string.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <include/timers.h>
+
+#define LCD_CLOCKDIVISION 8
+#define LCD_EXTRA_DIV 30
+#define LCD_TOP_DIV 60
+#include <include/display.h>
+#include <include/lcd_async.h>
+#include <include/lcd_glyph.h>
+#include <include/avrboard.h>
+
+/**
+ * @file
+ *
+ * @brief Test file for lcd_glyph.h
+ *
+ * Shows names with æ, ø and å and the bus traffic they cost. Line 4 shows
+ * the bytes sent for each test, "bus 41 0 17 6" is expected:
+ *
+ * <ul>
+ * 	<li>TEST 1 uploads three glyphs (27 bytes) plus the line.</li>
+ * 	<li>TEST 2 writes the same line again, 0 bytes.</li>
+ * 	<li>TEST 3 writes a Latin-1 line that needs one new glyph.</li>
+ * 	<li>TEST 4 writes five characters, two of them from overlong
+ * 	    sequences.</li>
+ * </ul>
+ *
+ * The LED lights up if the cache counters match.
+ */
+
+/**
+ * @brief Bytes on the bus for each test, shown in line 4.
+ */
+static char bus[ LCD_MAX_CHARS_LINE + 1 ] = "bus";
+
+/**
+ * @brief Waits for the display and adds the bytes sent to ::bus.
+ */
+void count_bus(void)
+{
+	lcd_async_flush();
+	strcat( bus , " " );
+	utoa( lcd_async_transfers , bus + strlen( bus ) , 10 );
+	lcd_async_transfers = 0;
+}
+
+int main(void)
+{
+	LED_ACTIVATE;
+	LED_OFF;
+
+	LCD_INIT;
+	lcd_async_init();
+	lcd_glyph_init();
+	sei();
+
+	/* TEST 1
+	 *
+	 * This is tested: lcd_glyph_write_line( uint8_t line , const char *text )
+	 * with UTF-8.
+	 *
+	 * Line 1 should read "Bjørn Ødegård".
+	 */
+	lcd_glyph_write_line( 1 , "Bj\xC3\xB8rn \xC3\x98" "deg\xC3\xA5rd" );
+	count_bus();
+
+	_delay_ms(2000);
+
+	/* TEST 2
+	 *
+	 * This is tested: glyphs that are cached.
+	 *
+	 * Nothing changes on the display and nothing is sent.
+	 */
+	lcd_glyph_write_line( 1 , "Bj\xC3\xB8rn \xC3\x98" "deg\xC3\xA5rd" );
+	count_bus();
+
+	/* TEST 3
+	 *
+	 * This is tested: lcd_glyph_write( uint8_t line , uint8_t column ,
+	 * const char *text ) with Latin-1.
+	 *
+	 * Line 2 should read "Kære år", æ is uploaded, å is taken from the cache.
+	 */
+	lcd_glyph_write( 2 , 0 , "K\xE6re \xE5r" );
+	count_bus();
+
+	/* TEST 4
+	 *
+	 * This is tested: overlong UTF-8 sequences.
+	 *
+	 * Line 3 should read "a?b?c". C0 80 would be a NUL and C1 BF a DEL,
+	 * both are shown as the fallback and take no slot.
+	 */
+	lcd_glyph_write( 3 , 0 , "a\xC0\x80" "b\xC1\xBF" "c" );
+	count_bus();
+
+	lcd_async_write_line( 4 , bus );
+
+	if ( lcd_glyph_counters.uploads == 4 && lcd_glyph_counters.hits == 4
+	  && lcd_glyph_counters.fallbacks == 2
+	  && strncmp( &lcd_shadow[ LCD_SHADOW_INDEX( 3 , 0 ) ] , "a?b?c" , 5 ) == 0 )
+	{
+		LED_ON;
+	}
+
+	while(1) {}
+}
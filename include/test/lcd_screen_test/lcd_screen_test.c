@@ -0,0 +1,151 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <string.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <include/timers.h>
+
+// The timing is calculated by lcd_timing.h.
+#include <include/display.h>
+#include <include/lcd_async.h>
+#include <include/lcd_screen.h>
+#include <include/avrboard.h>
+
+/**
+ * @file
+ *
+ * @brief Test file for lcd_screen.h
+ *
+ * Draws the same PIN entry screen once line by line with
+ * lcd_write_line( char *line_text ) and once from a screen in flash, then
+ * fills in the PIN. The results are shown in line 2 and 4:
+ *
+ * \code
+ * sync 7x screen 2x
+ * bus 31 2 1 1 1
+ * \endcode
+ *
+ * "sync" and "screen" are the times until the whole screen is on the
+ * display, in timer 2 counts of 102.4 microseconds. "bus" is the number of
+ * bytes sent for the screen and then for each digit of the PIN. The screen
+ * is drawn on a cleared display, so only the cells that are not blank are
+ * sent, with one address command per line.
+ */
+
+LCD_SCREEN( screen_pin ,
+	"Welcome             " ,
+	"                    " ,
+	"Enter PIN: ____     " ,
+	"                    " );
+
+/**
+ * @brief Name in line 1 of ::screen_pin.
+ */
+#define FIELD_NAME LCD_FIELD( 1 , 8 , 12 )
+
+/**
+ * @brief PIN in line 3 of ::screen_pin.
+ */
+#define FIELD_PIN LCD_FIELD( 3 , 11 , 4 )
+
+/**
+ * @brief Line 2 of the results.
+ */
+#define FIELD_TIMES LCD_FIELD( 2 , 0 , 20 )
+
+/**
+ * @brief Line 4 of the results.
+ */
+#define FIELD_BUS LCD_FIELD( 4 , 0 , 20 )
+
+/**
+ * @brief The same screen as ::screen_pin in RAM, the way it was done before.
+ */
+static char *lines[4] = {
+	"Welcome Hannes      ",
+	"                    ",
+	"Enter PIN: ____     ",
+	"                    "
+};
+
+/**
+ * @brief Timer 2 counts in steps of 1024 CPU cycles.
+ */
+#define TIMER2_START ( TCCR2 = _BV( CS22 ) | _BV( CS21 ) | _BV( CS20 ) )
+
+int main(void)
+{
+	uint8_t line;
+	uint8_t time_sync;
+	uint8_t time_screen;
+	uint8_t digit;
+	char pin[5] = "____";
+	char times[ LCD_MAX_CHARS_LINE + 1 ];
+	char bus[ LCD_MAX_CHARS_LINE + 1 ];
+
+	/* TEST 1
+	 *
+	 * This is tested: nothing new, the blocking way for comparison.
+	 *
+	 * The PIN screen should be shown.
+	 */
+	LCD_INIT;
+	TIMER2_START;
+	TCNT2 = 0;
+	for ( line = 1; line <= 4; line++ )
+	{
+		LCD_JUMP_LINE_START( line );
+		lcd_write_line( lines[ line - 1 ] );
+	}
+	time_sync = TCNT2;
+
+	_delay_ms(3000);
+
+	/* TEST 2
+	 *
+	 * This is tested: LCD_SCREEN, lcd_screen_show( const char *screen ) and
+	 * lcd_screen_field( uint8_t cell , uint8_t width , const char *text ).
+	 *
+	 * The display is cleared first, so the whole screen has to be sent. The
+	 * same screen as in TEST 1 should appear.
+	 */
+	LCD_CLEAR;
+	lcd_async_init();
+	sei();
+
+	TCNT2 = 0;
+	lcd_screen_show( screen_pin );
+	lcd_screen_field( FIELD_NAME , "Hannes" );
+	lcd_async_flush();
+	time_screen = TCNT2;
+	strcpy( bus , "bus " );
+	utoa( lcd_async_transfers , bus + strlen( bus ) , 10 );
+
+	/* TEST 3
+	 *
+	 * This is tested: lcd_screen_field( uint8_t cell , uint8_t width ,
+	 * const char *text ) on a shown screen.
+	 *
+	 * The PIN is filled with stars one by one. Each star should cost 2
+	 * bytes, or 1 if the address counter is already there.
+	 */
+	for ( digit = 0; digit < 4; digit++ )
+	{
+		_delay_ms(500);
+		lcd_async_transfers = 0;
+		pin[ digit ] = '*';
+		lcd_screen_field( FIELD_PIN , pin );
+		lcd_async_flush();
+		strcat( bus , " " );
+		utoa( lcd_async_transfers , bus + strlen( bus ) , 10 );
+	}
+
+	strcpy( times , "sync " );
+	utoa( time_sync , times + strlen( times ) , 10 );
+	strcat( times , " screen " );
+	utoa( time_screen , times + strlen( times ) , 10 );
+	lcd_screen_field( FIELD_TIMES , times );
+	lcd_screen_field( FIELD_BUS , bus );
+
+	while(1) {}
+}
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * @file
+ *
+ * @brief Host test for protothread.h
+ *
+ * Built and run on the development computer (make run), like
+ * host_cmd_test.c. protothread.h does not touch any AVR register. The
+ * soft_timer.h functions used by ::PT_WAIT_UNTIL_TIMEOUT are replaced by a
+ * timer that is counted down by hand.
+ *
+ * The test prints one line per test and "FAILED" if a check did not work.
+ * The exit code is the number of failed tests.
+ */
+
+/**
+ * @brief Replaces the timer of soft_timer.h.
+ */
+struct soft_timer
+{
+	uint16_t left;          /**< ticks until expiry, 0 while stopped */
+	volatile uint8_t fired; /**< set on expiry */
+};
+
+void soft_timer_start(struct soft_timer *timer, uint16_t delay, uint16_t period)
+{
+	timer->left = delay;
+	timer->fired = 0;
+}
+
+void soft_timer_stop(struct soft_timer *timer)
+{
+	timer->left = 0;
+}
+
+/**
+ * @brief One tick of the replaced timer.
+ */
+static void tick(struct soft_timer *timer)
+{
+	if ( timer->left && --timer->left == 0 )
+	{
+		timer->fired = 1;
+	}
+}
+
+#include <include/protothread.h>
+
+static int report(const char *name, int ok)
+{
+	printf( "%-40s %s\n" , name , ok ? "ok" : "FAILED" );
+	return !ok;
+}
+
+/**
+ * @brief Inputs of the threads, set by the test like an interrupt would.
+ */
+static uint8_t card;
+static uint8_t read_done;
+static uint8_t queue_room;
+static uint8_t events;
+
+/**
+ * @brief Outputs of the threads.
+ */
+static uint8_t reads_started;
+static uint8_t frames_sent;
+static uint8_t steps;
+
+/**
+ * @brief Takes a place in the queue if there is one.
+ */
+static uint8_t queue_take(void)
+{
+	if ( !queue_room )
+	{
+		return 0;
+	}
+	queue_room--;
+	return 1;
+}
+
+/**
+ * @brief A card reader flow: card, read, card gone, send.
+ */
+static PT_THREAD( reader( struct pt *pt ) )
+{
+	PT_BEGIN( pt );
+	while(1)
+	{
+		PT_WAIT_UNTIL( pt , card );
+		PT_POLL_UNTIL( pt , queue_take() );
+		reads_started++;
+		PT_WAIT_UNTIL( pt , read_done );
+		PT_WAIT_WHILE( pt , card );
+		PT_POLL_UNTIL( pt , queue_take() );
+		frames_sent++;
+	}
+	PT_END( pt );
+}
+
+/**
+ * @brief Waits for an event, then yields once and ends.
+ */
+static PT_THREAD( stepper( struct pt *pt ) )
+{
+	PT_BEGIN( pt );
+	PT_WAIT_EVENT( pt , events , 0x04 );
+	steps++;
+	PT_YIELD( pt );
+	steps++;
+	PT_END( pt );
+}
+
+/**
+ * @brief Waits for a card for at most 10 ticks.
+ */
+static struct soft_timer timeout;
+static uint8_t timed_out;
+
+static PT_THREAD( waiter( struct pt *pt ) )
+{
+	PT_BEGIN( pt );
+	PT_WAIT_UNTIL_TIMEOUT( pt , card , &timeout , 10 );
+	timed_out = timeout.fired;
+	PT_END( pt );
+}
+
+int main(void)
+{
+	struct pt pt;
+	struct pt other;
+	int failed = 0;
+	int ok;
+	int i;
+
+	/* TEST 1
+	 *
+	 * This is tested: the reader flow waits for the card and the read,
+	 * yields while the queue is full and goes around for the next card.
+	 */
+	PT_INIT( &pt );
+	ok = reader( &pt ) == PT_WAITING && reads_started == 0;
+	card = 1;
+	ok = ok && reader( &pt ) == PT_YIELDED && reader( &pt ) == PT_YIELDED;
+	queue_room = 1;
+	ok = ok && reader( &pt ) == PT_WAITING && reads_started == 1;
+	read_done = 1;
+	ok = ok && reader( &pt ) == PT_WAITING;
+	card = 0;
+	ok = ok && reader( &pt ) == PT_YIELDED && frames_sent == 0;
+	queue_room = 1;
+	ok = ok && reader( &pt ) == PT_WAITING && frames_sent == 1;
+	card = 1;
+	queue_room = 1;
+	ok = ok && reader( &pt ) == PT_WAITING && reads_started == 2;
+	failed += report( "reader flow" , ok );
+
+	/* TEST 2
+	 *
+	 * This is tested: ::PT_WAIT_EVENT, ::PT_YIELD and ::PT_END, and two
+	 * threads of the same function waiting at different lines.
+	 */
+	PT_INIT( &pt );
+	PT_INIT( &other );
+	events = 0x03;
+	ok = stepper( &pt ) == PT_WAITING && steps == 0;
+	events = 0x04;
+	ok = ok && stepper( &pt ) == PT_YIELDED && steps == 1;
+	events = 0;
+	ok = ok && stepper( &other ) == PT_WAITING;
+	ok = ok && stepper( &pt ) == PT_ENDED && steps == 2;
+	ok = ok && pt.lc == 0 && other.lc != 0;
+	failed += report( "events, yield and end" , ok );
+
+	/* TEST 3
+	 *
+	 * This is tested: ::PT_WAIT_UNTIL_TIMEOUT ends on the condition, and
+	 * on the timeout.
+	 */
+	card = 0;
+	PT_INIT( &pt );
+	ok = waiter( &pt ) == PT_WAITING;
+	for ( i = 0; i < 5; i++ )
+	{
+		tick( &timeout );
+	}
+	card = 1;
+	ok = ok && waiter( &pt ) == PT_ENDED && !timed_out && timeout.left == 0;
+	card = 0;
+	ok = ok && waiter( &pt ) == PT_WAITING;
+	for ( i = 0; i < 9; i++ )
+	{
+		tick( &timeout );
+	}
+	ok = ok && waiter( &pt ) == PT_WAITING;
+	tick( &timeout );
+	ok = ok && waiter( &pt ) == PT_ENDED && timed_out;
+	failed += report( "wait with timeout" , ok );
+
+	/* TEST 4
+	 *
+	 * RAM of a thread, the switch it replaces kept one byte.
+	 */
+	printf( "RAM per thread: %u bytes\n" , (unsigned)sizeof( struct pt ) );
+	failed += report( "thread state is two bytes" , sizeof( struct pt ) == 2 );
+
+	return failed;
+}
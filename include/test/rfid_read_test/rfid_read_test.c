@@ -0,0 +1,125 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <include/baud.h>
+#include <stdlib.h>
+#include <string.h>
+#include <include/spi.h>
+#include <include/timers.h>
+#include <include/avrboard.h>
+#include <include/uart_driver.c>
+#include <include/rfid_read.h>
+
+/**
+ * @file
+ *
+ * @brief Measures how long a card UID read takes in burst mode and with the
+ *        old fixed gap between the bytes.
+ *
+ * The RFID module must be connected and a card must be on the reader. Each
+ * mode is measured ::RUNS times. Timer 1 runs with a clock division of 64, so
+ * one count is 6.4 microseconds at 10 MHz. The results are sent as text over
+ * the UART and can be read with any terminal program (19200 baud, 8N1):
+ *
+ * \code
+ * gap 0: 1xx
+ * gap 1: 1xxx
+ * gap 10: 1xxxx
+ * aborted: 0
+ * \endcode
+ *
+ * The number is the mean read time in timer counts. Gap 10 is the 1 ms pacing
+ * the state machine used before. "aborted" counts reads stopped by the
+ * watchdog, it should stay 0.
+ */
+
+/**
+ * @brief Number of reads per mode.
+ */
+#define RUNS 16
+
+/**
+ * @brief Gaps that are measured, in ticks of 100 microseconds.
+ */
+static const uint8_t gaps[] = { 0 , 1 , 10 };
+
+/**
+ * @brief Sends a label and a number as one text line.
+ *
+ * @param label text in front of the number.
+ * @param value number that should be printed.
+ */
+void print_result(char *label, uint16_t value)
+{
+	char number[6];
+
+	utoa(value, number, 10);
+	SendString(label);
+	SendString(number);
+	SendString("\r\n");
+}
+
+int main(void)
+{
+	uint8_t g;
+	uint8_t run;
+	uint32_t sum;
+	uint16_t aborted = 0;
+	char label[10];
+
+	LED_ACTIVATE;
+	LED_OFF;
+
+	/* SPI master, clock F_CPU/16. */
+	DDR_SPI |= _BV( DD_MOSI ) | _BV( DD_SCK ) | _BV( DD_SS );
+	SPCR = _BV( SPE ) | _BV( MSTR ) | _BV( SPR0 );
+
+	USART_Init( UART_UBRR , UART_USE_2X );
+	spi_async_init();
+	sei();
+
+	/* Timer 1 counts in steps of 64 CPU cycles. */
+	T1_CTC( 0xFFFF , 0xFFFF );
+	T1_START(64);
+
+	for ( g = 0; g < sizeof(gaps); g++ )
+	{
+		rfid_read_gap = gaps[g];
+		sum = 0;
+		for ( run = 0; run < RUNS; run++ )
+		{
+			/* TEST
+			 *
+			 * This is tested: rfid_read_start() in the mode set
+			 * by rfid_read_gap.
+			 *
+			 * The time from the start until the UID is in BUFFER.
+			 */
+			T1_RESET;
+			while ( !rfid_read_start() );
+			while ( rfid_read_status() != SPI_TXN_DONE
+			     && rfid_read_status() != SPI_TXN_ABORTED );
+			sum += TCNT1;
+			if ( rfid_read_status() == SPI_TXN_ABORTED )
+			{
+				aborted++;
+			}
+			_delay_ms(10);
+		}
+
+		strcpy( label , "gap " );
+		utoa( gaps[g] , label + 4 , 10 );
+		strcat( label , ": " );
+		print_result( label , sum / RUNS );
+	}
+	print_result( "aborted: " , aborted );
+	uart_tx_flush();
+
+	if ( aborted == 0 )
+	{
+		LED_ON;
+	}
+
+	while(1)
+	{
+	}
+}
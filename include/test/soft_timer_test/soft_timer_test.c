@@ -0,0 +1,216 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <string.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <include/timers.h>
+
+// The timing is calculated by lcd_timing.h.
+#include <include/display.h>
+#include <include/lcd_async.h>
+#include <include/clock.h>
+#ifdef SOFT_TIMER_TEST_DIMMER
+#include <include/dimmer.h>
+#endif
+#include <include/soft_timer.h>
+#include <include/avrboard.h>
+
+/**
+ * @file
+ *
+ * @brief Test file for soft_timer.h
+ *
+ * Built with "make" for the default mode, with
+ * "make TEST_DEFS=-DSOFT_TIMER_TICKLESS" for the tickless mode and with
+ * "make TEST_DEFS=-DSOFT_TIMER_TEST_DIMMER" for timer 2 shared with dimmer.h.
+ * The first two builds should show:
+ *
+ * \code
+ * fast 100
+ * slow 10 shot 1
+ * chain 9xxx
+ * \endcode
+ *
+ * "fast" counts a periodic timer of 10 ms and "slow" one of 100 ms, both
+ * during one second measured by a one-shot timer. "shot" is how often the
+ * one-shot timer expired, it must not repeat. Meanwhile the LED blinks every
+ * 250 ms from a callback.
+ *
+ * "chain" is the shortest time in microseconds from starting a 10 ms timer
+ * in a callback until it expired, over 10 rounds of two timers that start
+ * each other. The callback before takes 0.5 ms on purpose. It should be
+ * about 9984 in the default mode and must not be below 9830 in the tickless
+ * mode, one tick less than the 97 ticks of 10 ms.
+ *
+ * With dimmer.h a tick is one PWM period of 408 us, so 10 ms are 24 ticks
+ * and one second 2450. The build shows "fast 102" and "chain 9792", the
+ * rest is the same. An LED on PD7 (OC2) fades up and down during TEST 1.
+ */
+
+/**
+ * @brief Expiries of ::fast.
+ */
+volatile uint16_t fast_count = 0;
+
+/**
+ * @brief Expiries of ::slow.
+ */
+volatile uint16_t slow_count = 0;
+
+/**
+ * @brief Expiries of ::shot.
+ */
+volatile uint8_t shot_count = 0;
+
+void on_fast(void)
+{
+	fast_count++;
+}
+
+void on_slow(void)
+{
+	slow_count++;
+}
+
+void on_shot(void)
+{
+	shot_count++;
+}
+
+void on_blink(void)
+{
+	LED_TOGGLE;
+}
+
+struct soft_timer fast = { .callback = on_fast };
+struct soft_timer slow = { .callback = on_slow };
+struct soft_timer shot = { .callback = on_shot };
+struct soft_timer blink = { .callback = on_blink };
+
+/**
+ * @brief Rounds of ::first and ::second left.
+ */
+volatile uint8_t chain_rounds = 0;
+
+/**
+ * @brief Time ::first was started by on_second().
+ */
+uint32_t chain_start;
+
+/**
+ * @brief Shortest time from starting ::first until it expired, in ticks of
+ *        clock.h.
+ */
+uint32_t chain_min = 0xFFFFFFFF;
+
+void on_first(void);
+void on_second(void);
+
+struct soft_timer first = { .callback = on_first };
+struct soft_timer second = { .callback = on_second };
+
+/**
+ * @brief Starts ::second at once and then takes its time.
+ */
+void on_first(void)
+{
+	if ( clock_elapsed( chain_start ) < chain_min )
+	{
+		chain_min = clock_elapsed( chain_start );
+	}
+	if ( --chain_rounds )
+	{
+		soft_timer_start( &second , 1 , 0 );
+		/* A long callback, the match for second comes late. */
+		_delay_us( 500 );
+	}
+}
+
+/**
+ * @brief Starts ::first for 10 ms from now.
+ */
+void on_second(void)
+{
+	chain_start = clock_now();
+	soft_timer_start( &first , SOFT_TIMER_MS( 10 ) , 0 );
+}
+
+/**
+ * @brief Shows a label and a number in the display.
+ */
+void show_result(uint8_t line, uint8_t column, const char *label, uint16_t value)
+{
+	char text[ LCD_MAX_CHARS_LINE + 1 ];
+
+	strcpy( text , label );
+	utoa( value , text + strlen( text ) , 10 );
+	lcd_async_write( line , column , text );
+}
+
+int main(void)
+{
+#ifdef SOFT_TIMER_TEST_DIMMER
+	uint8_t level = 0;
+#endif
+
+	LED_ACTIVATE;
+	LED_OFF;
+
+	lcd_async_power_on();
+	clock_init();
+#ifdef SOFT_TIMER_TEST_DIMMER
+	dimmer_init();
+#endif
+	soft_timer_init();
+	sei();
+
+	soft_timer_start( &blink , SOFT_TIMER_MS( 250 ) , SOFT_TIMER_MS( 250 ) );
+
+	/* TEST 1
+	 *
+	 * This is tested: periodic and one-shot timers running at the same
+	 * time, started at different ticks.
+	 */
+	soft_timer_start( &shot , SOFT_TIMER_MS( 1000 ) , 0 );
+	soft_timer_start( &fast , SOFT_TIMER_MS( 10 ) , SOFT_TIMER_MS( 10 ) );
+	soft_timer_start( &slow , SOFT_TIMER_MS( 100 ) , SOFT_TIMER_MS( 100 ) );
+#ifdef SOFT_TIMER_TEST_DIMMER
+	/* The fades step in the same interrupt as the ticks. */
+	while ( !soft_timer_expired( &shot ) )
+	{
+		if ( !dimmer_fading() )
+		{
+			level = ~level;
+			dimmer_set( level , DIMMER_FADE_RATE );
+		}
+	}
+#else
+	while ( !soft_timer_expired( &shot ) );
+#endif
+	soft_timer_stop( &fast );
+	soft_timer_stop( &slow );
+
+	/* TEST 2
+	 *
+	 * This is tested: a one-shot timer does not come back and stopped
+	 * timers do not count on.
+	 */
+	_delay_ms(1500);
+
+	show_result( 1 , 0 , "fast " , fast_count );
+	show_result( 2 , 0 , "slow " , slow_count );
+	show_result( 2 , 8 , "shot " , shot_count );
+
+	/* TEST 3
+	 *
+	 * This is tested: a timer started in a callback counts its delay from
+	 * the call, also when it is started behind an expiry that was handled
+	 * late.
+	 */
+	chain_rounds = 10;
+	on_second();
+	while ( chain_rounds );
+	show_result( 3 , 0 , "chain " , CLOCK_TICKS_US( chain_min ) );
+
+	while(1) {}
+}
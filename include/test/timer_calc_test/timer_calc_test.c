@@ -0,0 +1,78 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <avr/interrupt.h>
+#include <include/timers.h>
+#include <include/avrboard.h>
+
+/**
+ * @file
+ *
+ * @brief Test file for the compile time setup in timers.h
+ *
+ * Timer 0 is set up for a compare match every 100 us, timer 1 for one every
+ * second, both with ::T0_CTC_CYCLES( CYCLES ) and ::T1_CTC_CYCLES( CYCLES ).
+ * Every second, the matches of timer 0 are compared with the expected 10000.
+ * If they agree to within one, the LED toggles, so it blinks slowly. If not,
+ * the LED stays off.
+ *
+ * At 10 MHz the compiler should pick clock division 8 and TOP 124 for timer
+ * 0, and clock division 256 and TOP 39062 for timer 1. The list file shows
+ * the register writes with these constants and no switch.
+ *
+ * The build must fail if one of the lines marked "must not build" is
+ * enabled.
+ */
+
+/**
+ * @brief Compare matches of timer 0 since the last second.
+ */
+volatile uint16_t t0_matches = 0;
+
+int main(void)
+{
+	uint16_t matches;
+
+	LED_ACTIVATE;
+	LED_OFF;
+
+	/* TEST 1
+	 *
+	 * This is tested: T0_CTC_CYCLES( CYCLES ), T1_CTC_CYCLES( CYCLES ),
+	 * TIMER_US_CYCLES( US ) and TIMER_HZ_CYCLES( HZ ).
+	 */
+	T0_CTC_INT_ON;
+	T0_CTC_CYCLES( TIMER_US_CYCLES( 100 ) );
+	T1_COMP_MATCH_TOP_CLEAR;
+	T1_CTC_CYCLES( TIMER_HZ_CYCLES( 1 ) );
+	sei();
+
+	/* TEST 2
+	 *
+	 * This is tested: values the timers can not do stop the build.
+	 */
+	// T0_CTC_CYCLES( TIMER_US_CYCLES( 30000 ) ); // must not build
+	// T1_START_DIV( 4 ); // must not build
+
+	while(1)
+	{
+		while ( !T1_COMP_MATCH_TOP );
+		T1_COMP_MATCH_TOP_CLEAR;
+		cli();
+		matches = t0_matches;
+		t0_matches = 0;
+		sei();
+
+		if ( matches >= 9999 && matches <= 10001 )
+		{
+			LED_TOGGLE;
+		}
+		else
+		{
+			LED_OFF;
+		}
+	}
+}
+
+ISR(TIMER0_COMP_vect)
+{
+	t0_matches++;
+}
@@ -0,0 +1,195 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <include/baud.h>
+#include <stdlib.h>
+#include <include/avrboard.h>
+#include <include/uart_driver.c>
+
+/**
+ * @file
+ *
+ * @brief Test file for the receive ring buffer in uart_driver.c
+ *
+ * PD0 (RXD) has to be connected to PD1 (TXD), so the USART receives what it
+ * sends. Take RXD off the level converter for that, TXD stays connected to
+ * the terminal program (19200 baud, 8N1), which shows the results.
+ *
+ * Expected output is something like "lost: 0 wrong: 0 kept: 31
+ * overflow: 9 dor: 1 fe: 1 stored: 0". Between the results the terminal
+ * shows the bytes of the tests as unreadable characters.
+ *
+ * "lost" and "wrong" count the bytes of a back-to-back stream of 200 bytes
+ * that did not come back or came back changed, both must be 0. "kept" is
+ * what the buffer holds after 40 bytes were received without reading, and
+ * "overflow" the difference of ::uart_rx_stats::buffer_overflows, together
+ * they must be 40. "dor" is the difference of
+ * ::uart_rx_stats::data_overruns after the receive interrupt was blocked
+ * for four bytes. "fe" is the difference of ::uart_rx_stats::frame_errors
+ * after a break on the line, and "stored" the bytes the break left in the
+ * buffer, it must be 0.
+ */
+
+/**
+ * @brief Bytes of the back-to-back stream in TEST 1.
+ */
+#define STREAM_LENGTH 200
+
+/**
+ * @brief Length of the break in TEST 4 in microseconds.
+ *
+ * 9.75 bit times: the receiver samples the stop bit as low in the middle of
+ * the tenth bit, and the line is high again before a new start bit could be
+ * seen.
+ */
+#define BREAK_US ( 39 * 1000000UL / ( 4 * UART_BAUD ) )
+
+/**
+ * @brief Sends a label and a number as one text line.
+ *
+ * @param label text in front of the number.
+ * @param value number that should be printed.
+ */
+void print_result(char *label, uint16_t value)
+{
+	char number[6];
+
+	utoa(value, number, 10);
+	SendString(label);
+	SendString(number);
+	SendString("\r\n");
+}
+
+/**
+ * @brief Waits until the last byte is back and empties the receive buffer.
+ */
+void drain(void)
+{
+	uint8_t byte;
+
+	uart_tx_flush();
+	_delay_ms(2);
+	while ( uart_rx_read(&byte) );
+}
+
+int main(void)
+{
+	struct uart_rx_stats before;
+	struct uart_rx_stats after;
+	uint8_t byte;
+	uint8_t i;
+	uint16_t sent = 0;
+	uint16_t received = 0;
+	uint16_t wrong = 0;
+	uint8_t kept;
+	uint8_t stored;
+
+	LED_ACTIVATE;
+	LED_OFF;
+
+	USART_Init( UART_UBRR , UART_USE_2X );
+	sei();
+	drain();
+
+	/* TEST 1
+	 *
+	 * This is tested: uart_rx_read(uint8_t *data) while the transmit
+	 * interrupt keeps the line busy without a gap.
+	 *
+	 * Every byte must come back once and in order.
+	 */
+	while ( sent < STREAM_LENGTH )
+	{
+		byte = sent;
+		if ( uart_tx_write(&byte, 1) )
+		{
+			sent++;
+		}
+		if ( uart_rx_read(&byte) )
+		{
+			if ( byte != (uint8_t)received )
+			{
+				wrong++;
+			}
+			received++;
+		}
+	}
+	uart_tx_flush();
+	_delay_ms(2);
+	while ( uart_rx_read(&byte) )
+	{
+		if ( byte != (uint8_t)received )
+		{
+			wrong++;
+		}
+		received++;
+	}
+
+	/* TEST 2
+	 *
+	 * This is tested: a full receive buffer.
+	 *
+	 * Nothing is read while 40 bytes come in, the buffer keeps the first
+	 * 31 and counts the rest as buffer overflows.
+	 */
+	uart_rx_get_stats(&before);
+	SendString("0123456789012345678901234567890123456789");
+	uart_tx_flush();
+	_delay_ms(2);
+	kept = uart_rx_available();
+	uart_rx_get_stats(&after);
+	print_result("lost: ", STREAM_LENGTH - received);
+	print_result("wrong: ", wrong);
+	print_result("kept: ", kept);
+	print_result("overflow: ", after.buffer_overflows - before.buffer_overflows);
+	drain();
+
+	/* TEST 3
+	 *
+	 * This is tested: a data overrun in hardware.
+	 *
+	 * With interrupts disabled four bytes are sent by polling. Two fit into
+	 * the receive FIFO, the third waits in the shift register and the start
+	 * bit of the fourth one causes the overrun.
+	 */
+	uart_rx_get_stats(&before);
+	cli();
+	for ( i = 0 ; i < 4 ; i++ )
+	{
+		while ( !(UCSRA & (1<<UDRE)) );
+		UDR = 'a' + i;
+	}
+	_delay_ms(3);
+	sei();
+	_delay_ms(1);
+	uart_rx_get_stats(&after);
+	print_result("dor: ", after.data_overruns - before.data_overruns);
+	drain();
+
+	/* TEST 4
+	 *
+	 * This is tested: a framing error.
+	 *
+	 * The transmitter is switched off and TXD is held low for one frame,
+	 * the receiver gets a 0 without a stop bit. The byte must be counted
+	 * and dropped.
+	 */
+	uart_rx_get_stats(&before);
+	PORTD |= _BV(PD1);
+	DDRD |= _BV(PD1);
+	UCSRB &= ~(1<<TXEN);
+	PORTD &= ~_BV(PD1);
+	_delay_us(BREAK_US);
+	PORTD |= _BV(PD1);
+	_delay_ms(1);
+	UCSRB |= (1<<TXEN);
+	DDRD &= ~_BV(PD1);
+	stored = uart_rx_available();
+	uart_rx_get_stats(&after);
+	print_result("fe: ", after.frame_errors - before.frame_errors);
+	print_result("stored: ", stored);
+	uart_tx_flush();
+
+	while(1)
+	{
+	}
+}
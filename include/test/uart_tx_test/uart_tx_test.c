@@ -0,0 +1,168 @@
+#define F_CPU 10000000UL // 10 MHz
+#include <util/delay.h>
+#include <include/baud.h>
+#include <stdlib.h>
+#include <include/timers.h>
+#include <include/avrboard.h>
+#include <include/uart_driver.c>
+#include <include/frame.h>
+
+/**
+ * @file
+ *
+ * @brief Compares the cycles SendString() costs with and without the
+ *        transmit ring buffer.
+ *
+ * Timer 1 runs without clock division, so its count value is the number of
+ * CPU cycles spent. The old polling path is kept in this file as
+ * polling_send_string() for reference. Both results are sent as text over the
+ * UART and can be read with any terminal program (19200 baud, 8N1).
+ *
+ * Expected output is something like "poll: 36xxx ring: 2xx dropped: 0
+ * retries: xxx frame dropped: 0". The polling path waits for seven of the
+ * eight bytes of a UID, about 5200 cycles each at 19200 baud. The ring buffer
+ * path only copies the bytes. "dropped" must be 0, a SendString() that waits
+ * for room does not lose any byte. "retries" counts how often frame_send()
+ * refused a UID frame while the buffer was full, "frame dropped" must still
+ * be 0. The frame itself shows up as a few unreadable characters.
+ */
+
+/**
+ * @brief Card UID like string used as payload for both measurements.
+ */
+static char uid[] = "04A2B3C4";
+
+/**
+ * @brief The polling SendString() as it was before the transmit buffer.
+ *
+ * @param s string to send.
+ */
+void polling_send_string(char *s)
+{
+	for ( ; *s != 0 ; s++ )
+	{
+		/* Wait for data to be transmitted */
+		while ( !(UCSRA & (1<<UDRE)) );
+		UDR = *s;
+	}
+}
+
+/**
+ * @brief Sends a label and a number as one text line.
+ *
+ * @param label text in front of the number.
+ * @param value number that should be printed.
+ */
+void print_result(char *label, uint16_t value)
+{
+	char number[6];
+
+	utoa(value, number, 10);
+	SendString(label);
+	SendString(number);
+	SendString("\r\n");
+}
+
+int main(void)
+{
+	uint16_t cycles_polling;
+	uint16_t cycles_ring;
+	uint16_t dropped_blocking;
+	uint16_t retries = 0;
+	uint16_t dropped_frame;
+
+	LED_ACTIVATE;
+	LED_OFF;
+
+	USART_Init( UART_UBRR , UART_USE_2X );
+	sei();
+
+	/* Timer 1 counts CPU cycles. */
+	T1_CTC( 0xFFFF , 0xFFFF );
+	T1_START(1);
+
+	/* TEST 1
+	 *
+	 * This is tested: the old polling path.
+	 *
+	 * The whole UID is on the line before the function returns.
+	 */
+	T1_RESET;
+	polling_send_string(uid);
+	cycles_polling = TCNT1;
+	SendString("\r\n");
+	uart_tx_flush();
+
+	/* TEST 2
+	 *
+	 * This is tested: SendString(char *s) with the transmit ring buffer.
+	 *
+	 * The function returns after copying the UID. The UID should still
+	 * appear completely on the terminal.
+	 */
+	T1_RESET;
+	SendString(uid);
+	cycles_ring = TCNT1;
+	SendString("\r\n");
+	uart_tx_flush();
+
+	/* TEST 3
+	 *
+	 * This is tested: uart_tx_write(const uint8_t *data, uint8_t length)
+	 * with a full buffer.
+	 *
+	 * The first block fills the buffer, the second one must be refused
+	 * completely. The LED lights up if the full buffer policy works.
+	 */
+	if ( uart_tx_write((const uint8_t *)"0123456789012345678901234567890", 31) == 31
+	  && uart_tx_write((const uint8_t *)uid, 8) == 0
+	  && uart_tx_dropped == 8 )
+	{
+		LED_ON;
+	}
+	uart_tx_flush();
+	SendString("\r\n");
+
+	/* TEST 4
+	 *
+	 * This is tested: SendString(char *s) with a string longer than the
+	 * buffer.
+	 *
+	 * It has to wait for free slots, which must not be counted as dropped
+	 * bytes.
+	 */
+	uart_tx_flush();
+	uart_tx_dropped = 0;
+	SendString("0123456789012345678901234567890123456789\r\n");
+	dropped_blocking = uart_tx_dropped;
+
+	/* TEST 5
+	 *
+	 * This is tested: frame_send(uint8_t type, const uint8_t *payload,
+	 * uint8_t length) retried while the buffer is full, like the reader
+	 * does with a UID.
+	 *
+	 * The frame is sent in the end, the refusals must not be counted as
+	 * dropped bytes.
+	 */
+	uart_tx_flush();
+	uart_tx_dropped = 0;
+	uart_tx_write((const uint8_t *)"01234567890123456789\r\n", 22);
+	while ( !frame_send(FRAME_TYPE_CARD_UID, (const uint8_t *)uid, 8) )
+	{
+		retries++;
+	}
+	dropped_frame = uart_tx_dropped;
+	SendString("\r\n");
+
+	print_result("poll: ", cycles_polling);
+	print_result("ring: ", cycles_ring);
+	print_result("dropped: ", dropped_blocking);
+	print_result("retries: ", retries);
+	print_result("frame dropped: ", dropped_frame);
+	uart_tx_flush();
+
+	while(1)
+	{
+	}
+}
@@ -343,6 +343,32 @@ void t0_stop()
 	OCR1B = COMP_EXTRA;\
 }while(0)
 
+/**
+ * @brief Setting up timer1 in normal mode
+ *
+ * The timer counts up to 0xFFFF and starts over at 0, it is never cleared on
+ * a compare match. The physical output pins OC1A and OC1B will be deactivated.
+ *
+ * This allows several users to share the running timer: each one schedules
+ * its next compare match relative to the current count, e.g.
+ * \code
+ * OCR1A = TCNT1 + DELAY;
+ * T1_CTC_INT_ON;
+ * \endcode
+ *
+ * @see T1_START( CLOCKDIVISION )
+ * @see T1_CTC_INT_ON
+ */
+#define T1_NORMAL do{ \
+\
+	/* Makeing sure physical pins OC1A and OC1B are not touched */\
+	TCCR1A &= ~(_BV( COM1A0 )|_BV( COM1A1 )|_BV( COM1B0 )|_BV( COM1B1 ));\
+\
+	/* Setup normal mode, clearing WGM13 to WGM10 */\
+	TCCR1A &= ~(_BV( WGM11 )|_BV( WGM10 ));\
+	TCCR1B &= ~(_BV( WGM13 )|_BV( WGM12 ));\
+}while(0)
+
 
 /**
  * @brief Represents timer 1 compare match state with TOP.
@@ -655,4 +681,480 @@ void t1_stop()
 #define T1_RESET ( TCNT1 = 0x0000 )
 
 
+/** 
+ * @brief Setting up timer2 in Clear Timer on Compare mode
+ *
+ * Works like ::T0_CTC( TOP ) for timer 2. The physical output pin OC2 is not
+ * used.
+ *
+ * @param TOP 8 bit value at wich the timer will be cleared.
+ *
+ * @see T2_START( CLOCKDIVISION )
+ * @see T2_CTC_INT_ON
+ */
+#define T2_CTC( TOP ) do{ \
+\
+	/* Makeing sure physical pin OC2 is not touched */\
+	TCCR2 &= ~(_BV( COM20 )|_BV( COM21 ));\
+\
+	/* Setup CTC mode in the TCCR2 register */\
+	TCCR2 |=  _BV( WGM21 );  /* Setting WGM21 */\
+	TCCR2 &= ~_BV( WGM20 );  /* Clearing WGM20 */\
+\
+	OCR2 = TOP;\
+}while(0)
+
+/**
+ * @brief Clears the compare match flag for timer 2
+ *
+ * Unlike ::T0_COMP_MATCH_CLEAR, only the flag of timer 2 is written, so
+ * pending flags of the other timers are not lost.
+ */
+#define T2_COMP_MATCH_CLEAR ( TIFR = _BV( OCF2 ) )
+
+/**
+ * @brief Deactivates CTC interupt for Timer 2
+ */
+#define T2_CTC_INT_OFF ( TIMSK &= ~_BV( OCIE2 ) )
+
+/**
+ * @brief Activates CTC interupt for Timer 2
+ */
+#define T2_CTC_INT_ON ( TIMSK |= _BV( OCIE2 ) )
+
+/**
+ * @brief Starting timer2.
+ *
+ * Timer 2 has more clock divisions than timer 0 and 1.
+ *
+ * @param CLOCKDIVISION Dividing factor for the main clock.
+ *                      Values are: \b 1 (no division), \b 8, \b 32, \b 64,
+ *                      \b 128, \b 256 and \b 1024.
+ *                      If another value than these is given then no division 
+ *                      will be applied.
+ * @see T2_STOP
+ */
+#define T2_START( CLOCKDIVISION ) do{ \
+	/* Converting CLOCKDIVISION to a binary represation. */\
+	TCCR2 &= ~(_BV( CS22 )|_BV( CS21 )|_BV( CS20 ));\
+	switch ( CLOCKDIVISION ) \
+	{ \
+		case 8:		TCCR2 |=  _BV( CS21 ); break; \
+		case 32:	TCCR2 |= (_BV( CS21 )|_BV( CS20 )); break; \
+		case 64:	TCCR2 |=  _BV( CS22 ); break; \
+		case 128:	TCCR2 |= (_BV( CS22 )|_BV( CS20 )); break; \
+		case 256:	TCCR2 |= (_BV( CS22 )|_BV( CS21 )); break; \
+		case 1024:	TCCR2 |= (_BV( CS22 )|_BV( CS21 )|_BV( CS20 )); break; \
+		default:	/* Default setting is the same as 1, no division. */ \
+				TCCR2 |=  _BV( CS20 ); break; \
+	} \
+}while(0)
+
+/**
+ * @brief Stopping timer2
+ *
+ * @see T2_START( CLOCKDIVISION )
+ */
+#define T2_STOP (TCCR2 &= ~(_BV( CS22 )|_BV( CS21 )|_BV( CS20 )) )
+
+/**
+ * @brief Resets timer 2 count value
+ *
+ * @see T2_START( CLOCKDIVISION )
+ */
+#define T2_RESET ( TCNT2 = 0x00 )
+
+/*
+ * Compile time setup
+ *
+ * The START macros above decide on the clock division with a switch, and
+ * fall back to no division for values the timer does not have. The macros
+ * below take constants only. They work the clock division and TOP out while
+ * compiling, compile to plain register writes and stop the build with an
+ * error for values the timer can not do.
+ */
+
+/**
+ * @brief Stops the build if a constant condition is false.
+ *
+ * Evaluates to 0. The error message is about an array of negative size.
+ *
+ * @param COND constant expression that must not be 0.
+ */
+#define TIMER_ASSERT( COND ) ( 0 * sizeof( char[ (COND) ? 1 : -1 ] ) )
+
+/**
+ * @brief CPU cycles for a time in microseconds, rounded.
+ */
+#define TIMER_US_CYCLES( US ) \
+	( ( (unsigned long long)(F_CPU) * (US) + 500000ULL ) / 1000000ULL )
+
+/**
+ * @brief CPU cycles for one period of a frequency in Hz, rounded.
+ */
+#define TIMER_HZ_CYCLES( HZ ) \
+	( ( (unsigned long long)(F_CPU) + (HZ) / 2 ) / (HZ) )
+
+/**
+ * @brief Timer counts for a number of CPU cycles and a clock division,
+ *        rounded.
+ */
+#define TIMER_COUNTS( CYCLES , DIV ) ( ( (CYCLES) + (DIV) / 2 ) / (DIV) )
+
+/**
+ * @brief Value of ::TIMER_ERROR for a clock division that can not be used.
+ */
+#define TIMER_NONE 0xFFFFFFFFFFFFFFFFULL
+
+/**
+ * @brief Error in CPU cycles of a period with a clock division.
+ *
+ * @param CYCLES wanted period in CPU cycles.
+ * @param DIV clock division.
+ * @param MAX most counts per period, 256 for 8 bit and 65536 for 16 bit.
+ *
+ * @return the error, or ::TIMER_NONE if the period does not fit.
+ */
+#define TIMER_ERROR( CYCLES , DIV , MAX ) \
+	( TIMER_COUNTS( CYCLES , DIV ) < 1 || TIMER_COUNTS( CYCLES , DIV ) > (MAX) ? TIMER_NONE \
+	: TIMER_COUNTS( CYCLES , DIV ) * (DIV) > (CYCLES) \
+	? TIMER_COUNTS( CYCLES , DIV ) * (DIV) - (CYCLES) \
+	: (CYCLES) - TIMER_COUNTS( CYCLES , DIV ) * (DIV) )
+
+/**
+ * @brief Clock division of timer 0 or 1 with the smallest error for a period.
+ *
+ * Of equal errors the smaller clock division wins.
+ *
+ * @param CYCLES wanted period in CPU cycles.
+ * @param MAX most counts per period, 256 for 8 bit and 65536 for 16 bit.
+ */
+#define TIMER_BEST_DIV( CYCLES , MAX ) ( \
+	TIMER_ERROR( CYCLES , 1 , MAX ) <= TIMER_ERROR( CYCLES , 8 , MAX ) \
+	&& TIMER_ERROR( CYCLES , 1 , MAX ) <= TIMER_ERROR( CYCLES , 64 , MAX ) \
+	&& TIMER_ERROR( CYCLES , 1 , MAX ) <= TIMER_ERROR( CYCLES , 256 , MAX ) \
+	&& TIMER_ERROR( CYCLES , 1 , MAX ) <= TIMER_ERROR( CYCLES , 1024 , MAX ) ? 1 \
+	: TIMER_ERROR( CYCLES , 8 , MAX ) <= TIMER_ERROR( CYCLES , 64 , MAX ) \
+	&& TIMER_ERROR( CYCLES , 8 , MAX ) <= TIMER_ERROR( CYCLES , 256 , MAX ) \
+	&& TIMER_ERROR( CYCLES , 8 , MAX ) <= TIMER_ERROR( CYCLES , 1024 , MAX ) ? 8 \
+	: TIMER_ERROR( CYCLES , 64 , MAX ) <= TIMER_ERROR( CYCLES , 256 , MAX ) \
+	&& TIMER_ERROR( CYCLES , 64 , MAX ) <= TIMER_ERROR( CYCLES , 1024 , MAX ) ? 64 \
+	: TIMER_ERROR( CYCLES , 256 , MAX ) <= TIMER_ERROR( CYCLES , 1024 , MAX ) ? 256 : 1024 )
+
+/**
+ * @brief TOP for ::TIMER_BEST_DIV( CYCLES , MAX ).
+ */
+#define TIMER_BEST_TOP( CYCLES , MAX ) \
+	( TIMER_COUNTS( CYCLES , TIMER_BEST_DIV( CYCLES , MAX ) ) - 1 )
+
+/**
+ * @brief Stops the build if a period does not fit timer 0 or 1.
+ *
+ * The ranges of the clock divisions overlap, so a period fits if it is at
+ * least one cycle and fits the largest division.
+ */
+#define TIMER_ASSERT_PERIOD( CYCLES , MAX ) \
+	TIMER_ASSERT( (CYCLES) >= 1 && TIMER_COUNTS( CYCLES , 1024 ) <= (MAX) )
+
+/**
+ * @brief Clock select bits of timer 0 and 1 for a constant clock division.
+ *
+ * Stops the build for values other than 1, 8, 64, 256 and 1024.
+ *
+ * @param DIV clock division, a constant.
+ * @param CS2 bit number of CS02 or CS12.
+ * @param CS1 bit number of CS01 or CS11.
+ * @param CS0 bit number of CS00 or CS10.
+ */
+#define TIMER_CS_BITS( DIV , CS2 , CS1 , CS0 ) ( TIMER_ASSERT( (DIV) == 1 \
+		|| (DIV) == 8 || (DIV) == 64 || (DIV) == 256 || (DIV) == 1024 ) \
+	+ ( (DIV) == 1 ? _BV( CS0 ) \
+	: (DIV) == 8 ? _BV( CS1 ) \
+	: (DIV) == 64 ? _BV( CS1 ) | _BV( CS0 ) \
+	: (DIV) == 256 ? _BV( CS2 ) \
+	: _BV( CS2 ) | _BV( CS0 ) ) )
+
+/**
+ * @brief Starts timer 0 with a constant clock division.
+ *
+ * Like ::T0_START( CLOCKDIVISION ) without the switch. Values the timer does
+ * not have stop the build.
+ *
+ * @param DIV \b 1, \b 8, \b 64, \b 256 or \b 1024, a constant.
+ */
+#define T0_START_DIV( DIV ) ( TCCR0 = ( TCCR0 & ~(_BV( CS02 )|_BV( CS01 )|_BV( CS00 )) ) \
+	| TIMER_CS_BITS( DIV , CS02 , CS01 , CS00 ) )
+
+/**
+ * @brief Starts timer 1 with a constant clock division.
+ *
+ * Like ::T1_START( CLOCKDIVISION ) without the switch. Values the timer does
+ * not have stop the build.
+ *
+ * @param DIV \b 1, \b 8, \b 64, \b 256 or \b 1024, a constant.
+ */
+#define T1_START_DIV( DIV ) ( TCCR1B = ( TCCR1B & ~(_BV( CS12 )|_BV( CS11 )|_BV( CS10 )) ) \
+	| TIMER_CS_BITS( DIV , CS12 , CS11 , CS10 ) )
+
+/**
+ * @brief Starts timer 2 with a constant clock division.
+ *
+ * Like ::T2_START( CLOCKDIVISION ) without the switch. Values the timer does
+ * not have stop the build.
+ *
+ * @param DIV \b 1, \b 8, \b 32, \b 64, \b 128, \b 256 or \b 1024, a
+ *            constant.
+ */
+#define T2_START_DIV( DIV ) ( TCCR2 = ( TCCR2 & ~(_BV( CS22 )|_BV( CS21 )|_BV( CS20 )) ) \
+	| ( TIMER_ASSERT( (DIV) == 1 || (DIV) == 8 || (DIV) == 32 || (DIV) == 64 \
+		|| (DIV) == 128 || (DIV) == 256 || (DIV) == 1024 ) \
+	+ ( (DIV) == 1 ? _BV( CS20 ) \
+	: (DIV) == 8 ? _BV( CS21 ) \
+	: (DIV) == 32 ? _BV( CS21 ) | _BV( CS20 ) \
+	: (DIV) == 64 ? _BV( CS22 ) \
+	: (DIV) == 128 ? _BV( CS22 ) | _BV( CS20 ) \
+	: (DIV) == 256 ? _BV( CS22 ) | _BV( CS21 ) \
+	: _BV( CS22 ) | _BV( CS21 ) | _BV( CS20 ) ) ) )
+
+/**
+ * @brief Sets timer 0 up in CTC mode for a period and starts it.
+ *
+ * Clock division and TOP are chosen while compiling, with the smallest error
+ * of all clock divisions. This compiles to two register writes. Periods that
+ * do not fit stop the build.
+ *
+ * Example, a compare match every 100 us:
+ * \code
+ * T0_CTC_CYCLES( TIMER_US_CYCLES( 100 ) );
+ * \endcode
+ *
+ * @param CYCLES period in CPU cycles, a constant. See ::TIMER_US_CYCLES and
+ *               ::TIMER_HZ_CYCLES.
+ *
+ * @see T0_CTC( TOP )
+ */
+#define T0_CTC_CYCLES( CYCLES ) do{ \
+	OCR0 = TIMER_BEST_TOP( CYCLES , 256 ) + TIMER_ASSERT_PERIOD( CYCLES , 256 );\
+	/* CTC mode, OC0 not touched, clock started. */\
+	TCCR0 = _BV( WGM01 ) | TIMER_CS_BITS( TIMER_BEST_DIV( CYCLES , 256 ) , CS02 , CS01 , CS00 );\
+}while(0)
+
+/**
+ * @brief Sets timer 1 up in CTC mode for a period and starts it.
+ *
+ * Like ::T0_CTC_CYCLES( CYCLES ) for timer 1, with TOP in OCR1A.
+ *
+ * @param CYCLES period in CPU cycles, a constant.
+ *
+ * @see T1_CTC( TOP , COMP_EXTRA )
+ */
+#define T1_CTC_CYCLES( CYCLES ) do{ \
+	OCR1A = TIMER_BEST_TOP( CYCLES , 65536 ) + TIMER_ASSERT_PERIOD( CYCLES , 65536 );\
+	/* CTC mode with TOP in OCR1A, OC1A and OC1B not touched. */\
+	TCCR1A = 0;\
+	TCCR1B = _BV( WGM12 ) | TIMER_CS_BITS( TIMER_BEST_DIV( CYCLES , 65536 ) , CS12 , CS11 , CS10 );\
+}while(0)
+
+
+/*
+ * Pulse width modulation
+ *
+ * The PWM modes drive the output compare pins of the ATmega32: OC0 (PB3),
+ * OC1A (PD5), OC1B (PD4) and OC2 (PD7). The duty is set in the output
+ * compare register, which the timer only takes over at TOP (fast PWM) or
+ * BOTTOM (phase correct PWM), so changing it never gives a short pulse.
+ *
+ * Fast PWM counts up only and has twice the frequency of phase correct PWM.
+ * Phase correct PWM counts up and down, a duty of 0 keeps the pin low and a
+ * duty of TOP keeps it high, without the spike fast PWM gives at 0.
+ *
+ * The clock division is set with the START macros, the frequency is
+ * F_CPU / DIV / ( TOP + 1 ) for fast PWM and F_CPU / DIV / ( 2 * TOP ) for
+ * phase correct PWM.
+ *
+ * Example, OC2 at 2.4 kHz with a quarter duty:
+ *
+ *	T2_PHASE_PWM;
+ *	T2_PWM_DUTY( 64 );
+ *	T2_PWM_OUTPUT_ON;
+ *	T2_START_DIV( 8 );
+ *
+ * Timer 1 is used in normal mode by lcd_async.h, lcd_marquee.h and clock.h,
+ * timer 0 by rfid_read.h while a card is read and timer 2 by soft_timer.h.
+ * A timer can only be used for PWM if none of them is used with it. The
+ * exception is dimmer.h, whose PWM on timer 2 also ticks soft_timer.h.
+ */
+
+/**
+ * @brief Sets up timer 0 in fast PWM mode, TOP is 0xFF.
+ *
+ * The pin OC0 is not touched, see ::T0_PWM_OUTPUT_ON.
+ */
+#define T0_FAST_PWM ( TCCR0 |= _BV( WGM01 ) | _BV( WGM00 ) )
+
+/**
+ * @brief Sets up timer 0 in phase correct PWM mode, TOP is 0xFF.
+ *
+ * The pin OC0 is not touched, see ::T0_PWM_OUTPUT_ON.
+ */
+#define T0_PHASE_PWM ( TCCR0 = ( TCCR0 & ~_BV( WGM01 ) ) | _BV( WGM00 ) )
+
+/**
+ * @brief Sets the duty of OC0.
+ *
+ * @param DUTY high counts of the period, 0 to 0xFF.
+ */
+#define T0_PWM_DUTY( DUTY ) ( OCR0 = (DUTY) )
+
+/**
+ * @brief Connects OC0 (PB3) to timer 0, high while the count is below the
+ *        duty, and makes it an output.
+ */
+#define T0_PWM_OUTPUT_ON do{ \
+	TCCR0 = ( TCCR0 & ~_BV( COM00 ) ) | _BV( COM01 );\
+	DDRB |= _BV( PB3 );\
+}while(0)
+
+/**
+ * @brief Disconnects OC0, the pin shows its PORTB bit again.
+ */
+#define T0_PWM_OUTPUT_OFF ( TCCR0 &= ~(_BV( COM01 )|_BV( COM00 )) )
+
+/**
+ * @brief Activates the overflow interrupt of timer 0, at BOTTOM in phase
+ *        correct PWM mode and at TOP in fast PWM mode.
+ */
+#define T0_OVF_INT_ON ( TIMSK |= _BV( TOIE0 ) )
+
+/**
+ * @brief Deactivates the overflow interrupt of timer 0.
+ */
+#define T0_OVF_INT_OFF ( TIMSK &= ~_BV( TOIE0 ) )
+
+/**
+ * @brief Sets up timer 1 in fast PWM mode with TOP in ICR1.
+ *
+ * Both channels, OC1A and OC1B, can be used. The pins are not touched, see
+ * ::T1A_PWM_OUTPUT_ON and ::T1B_PWM_OUTPUT_ON.
+ *
+ * @param TOP 16 bit value at which the period ends, sets the resolution.
+ */
+#define T1_FAST_PWM( TOP ) do{ \
+	ICR1 = TOP;\
+	/* Mode 14, WGM13 to WGM11 set */\
+	TCCR1A = ( TCCR1A & ~_BV( WGM10 ) ) | _BV( WGM11 );\
+	TCCR1B |= _BV( WGM13 ) | _BV( WGM12 );\
+}while(0)
+
+/**
+ * @brief Sets up timer 1 in phase correct PWM mode with TOP in ICR1.
+ *
+ * Like ::T1_FAST_PWM( TOP ), with half the frequency.
+ *
+ * @param TOP 16 bit value at which the timer counts down again.
+ */
+#define T1_PHASE_PWM( TOP ) do{ \
+	ICR1 = TOP;\
+	/* Mode 10, WGM13 and WGM11 set */\
+	TCCR1A = ( TCCR1A & ~_BV( WGM10 ) ) | _BV( WGM11 );\
+	TCCR1B = ( TCCR1B & ~_BV( WGM12 ) ) | _BV( WGM13 );\
+}while(0)
+
+/**
+ * @brief Sets the duty of OC1A.
+ *
+ * @param DUTY high counts of the period, 0 to TOP.
+ */
+#define T1A_PWM_DUTY( DUTY ) ( OCR1A = (DUTY) )
+
+/**
+ * @brief Sets the duty of OC1B.
+ *
+ * @param DUTY high counts of the period, 0 to TOP.
+ */
+#define T1B_PWM_DUTY( DUTY ) ( OCR1B = (DUTY) )
+
+/**
+ * @brief Connects OC1A (PD5) to timer 1 and makes it an output.
+ */
+#define T1A_PWM_OUTPUT_ON do{ \
+	TCCR1A = ( TCCR1A & ~_BV( COM1A0 ) ) | _BV( COM1A1 );\
+	DDRD |= _BV( PD5 );\
+}while(0)
+
+/**
+ * @brief Disconnects OC1A, the pin shows its PORTD bit again.
+ */
+#define T1A_PWM_OUTPUT_OFF ( TCCR1A &= ~(_BV( COM1A1 )|_BV( COM1A0 )) )
+
+/**
+ * @brief Connects OC1B (PD4) to timer 1 and makes it an output.
+ */
+#define T1B_PWM_OUTPUT_ON do{ \
+	TCCR1A = ( TCCR1A & ~_BV( COM1B0 ) ) | _BV( COM1B1 );\
+	DDRD |= _BV( PD4 );\
+}while(0)
+
+/**
+ * @brief Disconnects OC1B, the pin shows its PORTD bit again.
+ */
+#define T1B_PWM_OUTPUT_OFF ( TCCR1A &= ~(_BV( COM1B1 )|_BV( COM1B0 )) )
+
+/**
+ * @brief Activates the overflow interrupt of timer 1, at BOTTOM in phase
+ *        correct PWM mode and at TOP in fast PWM mode.
+ */
+#define T1_OVF_INT_ON ( TIMSK |= _BV( TOIE1 ) )
+
+/**
+ * @brief Deactivates the overflow interrupt of timer 1.
+ */
+#define T1_OVF_INT_OFF ( TIMSK &= ~_BV( TOIE1 ) )
+
+/**
+ * @brief Sets up timer 2 in fast PWM mode, TOP is 0xFF.
+ *
+ * The pin OC2 is not touched, see ::T2_PWM_OUTPUT_ON.
+ */
+#define T2_FAST_PWM ( TCCR2 |= _BV( WGM21 ) | _BV( WGM20 ) )
+
+/**
+ * @brief Sets up timer 2 in phase correct PWM mode, TOP is 0xFF.
+ *
+ * The pin OC2 is not touched, see ::T2_PWM_OUTPUT_ON.
+ */
+#define T2_PHASE_PWM ( TCCR2 = ( TCCR2 & ~_BV( WGM21 ) ) | _BV( WGM20 ) )
+
+/**
+ * @brief Sets the duty of OC2.
+ *
+ * @param DUTY high counts of the period, 0 to 0xFF.
+ */
+#define T2_PWM_DUTY( DUTY ) ( OCR2 = (DUTY) )
+
+/**
+ * @brief Connects OC2 (PD7) to timer 2 and makes it an output.
+ */
+#define T2_PWM_OUTPUT_ON do{ \
+	TCCR2 = ( TCCR2 & ~_BV( COM20 ) ) | _BV( COM21 );\
+	DDRD |= _BV( PD7 );\
+}while(0)
+
+/**
+ * @brief Disconnects OC2, the pin shows its PORTD bit again.
+ */
+#define T2_PWM_OUTPUT_OFF ( TCCR2 &= ~(_BV( COM21 )|_BV( COM20 )) )
+
+/**
+ * @brief Activates the overflow interrupt of timer 2, at BOTTOM in phase
+ *        correct PWM mode and at TOP in fast PWM mode.
+ */
+#define T2_OVF_INT_ON ( TIMSK |= _BV( TOIE2 ) )
+
+/**
+ * @brief Deactivates the overflow interrupt of timer 2.
+ */
+#define T2_OVF_INT_OFF ( TIMSK &= ~_BV( TOIE2 ) )
+
+
 #endif /* TIMERS_H_INCLUDED */
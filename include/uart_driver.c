@@ -2,6 +2,10 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <util/atomic.h>
+#include "uart_driver.h"
 
 /**
  * @file
@@ -18,54 +22,296 @@
 
 
 
-unsigned char ch;//
+#ifndef UART_RX_BUFFER_SIZE
+/**
+ * @brief Size of the receive ring buffer in bytes.
+ *
+ * Must be a power of two not bigger than 128, for the same reasons as
+ * ::UART_TX_BUFFER_SIZE. Can be overridden by defining it before this file is
+ * compiled.
+ *
+ * @see uart_rx_read
+ */
+#define UART_RX_BUFFER_SIZE 32
+#endif
+
+#if ( UART_RX_BUFFER_SIZE & ( UART_RX_BUFFER_SIZE - 1 ) ) || UART_RX_BUFFER_SIZE > 128
+#error "UART_RX_BUFFER_SIZE must be a power of two not bigger than 128"
+#endif
+
+/**
+ * @brief Mask used to wrap the receive ring buffer indices.
+ */
+#define UART_RX_BUFFER_MASK ( UART_RX_BUFFER_SIZE - 1 )
+
+/**
+ * @brief Receive ring buffer, filled by ISR(USART_RXC_vect).
+ */
+static volatile uint8_t uart_rx_buffer[ UART_RX_BUFFER_SIZE ];
+
+/**
+ * @brief Index of the next free slot. Only written by the ISR.
+ */
+static volatile uint8_t uart_rx_head = 0;
+
+/**
+ * @brief Index of the next byte to be read. Only written by the main loop.
+ */
+static volatile uint8_t uart_rx_tail = 0;
+
+/**
+ * @brief Receive error counters, see uart_rx_get_stats().
+ */
+static volatile struct uart_rx_stats uart_rx_counters;
+
+/**
+ * @brief Called from ISR(USART_RXC_vect) after a byte was stored, may be 0.
+ *
+ * Lets the main loop know that there is something to read, e.g. to wake it
+ * up.
+ */
+void (*uart_rx_event)(void) = 0;
+
+#ifndef UART_TX_BUFFER_SIZE
+/**
+ * @brief Size of the transmit ring buffer in bytes.
+ *
+ * Must be a power of two not bigger than 128, so that the head and tail
+ * indices can be wrapped with a mask and fit into one byte. Can be overridden
+ * by defining it before this file is compiled.
+ *
+ * @see uart_tx_write
+ */
+#define UART_TX_BUFFER_SIZE 32
+#endif
+
+#if ( UART_TX_BUFFER_SIZE & ( UART_TX_BUFFER_SIZE - 1 ) ) || UART_TX_BUFFER_SIZE > 128
+#error "UART_TX_BUFFER_SIZE must be a power of two not bigger than 128"
+#endif
+
+/**
+ * @brief Mask used to wrap the transmit ring buffer indices.
+ */
+#define UART_TX_BUFFER_MASK ( UART_TX_BUFFER_SIZE - 1 )
+
+/**
+ * @brief Transmit ring buffer, drained by ISR(USART_UDRE_vect).
+ */
+static volatile uint8_t uart_tx_buffer[ UART_TX_BUFFER_SIZE ];
+
+/**
+ * @brief Index of the next free slot. Only written by the main loop.
+ */
+static volatile uint8_t uart_tx_head = 0;
+
+/**
+ * @brief Index of the next byte to be sent. Only written by the ISR.
+ */
+static volatile uint8_t uart_tx_tail = 0;
+
+/**
+ * @brief Set by the ISR when a byte was loaded into UDR, cleared by
+ *        uart_tx_flush().
+ */
+static volatile uint8_t uart_tx_sent = 0;
+
+/**
+ * @brief Counts bytes rejected by uart_tx_write() because the buffer was full.
+ */
+volatile uint16_t uart_tx_dropped = 0;
+
+/**
+ * @brief Number of received bytes waiting in the receive buffer.
+ *
+ * @see uart_rx_read
+ */
+uint8_t uart_rx_available(void)
+{
+	return ( uart_rx_head - uart_rx_tail ) & UART_RX_BUFFER_MASK;
+}
+
+/**
+ * @brief Takes one byte out of the receive buffer without waiting.
+ *
+ * The receive buffer is a single producer, single consumer queue: only
+ * ISR(USART_RXC_vect) moves the head and only this function moves the tail.
+ * Both are single bytes, so no interrupts need to be disabled.
+ *
+ * @param data where the received byte is stored.
+ *
+ * @return 1 if a byte was read, 0 if the buffer was empty.
+ */
+uint8_t uart_rx_read(uint8_t *data)
+{
+	uint8_t tail = uart_rx_tail;
 
+	if ( tail == uart_rx_head )
+	{
+		return 0;
+	}
+	*data = uart_rx_buffer[ tail ];
+	/* Hand the slot back to the ISR. */
+	uart_rx_tail = ( tail + 1 ) & UART_RX_BUFFER_MASK;
 
-char flag_u=0;
+	return 1;
+}
+
+/**
+ * @brief Copies the receive error counters.
+ *
+ * The counters are only written by the ISR and never reset, the difference
+ * between two calls shows how many errors happened in between.
+ *
+ * @param stats where the counters are copied to.
+ */
+void uart_rx_get_stats(struct uart_rx_stats *stats)
+{
+	ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+	{
+		stats->frame_errors = uart_rx_counters.frame_errors;
+		stats->data_overruns = uart_rx_counters.data_overruns;
+		stats->buffer_overflows = uart_rx_counters.buffer_overflows;
+	}
+}
 
 /* 
- * @brief method for receiving data using polling
+ * @brief method for receiving data, waits until a byte is in the receive buffer
  *
+ * @see uart_rx_read
  */
 char usart_receive()
 {
+	uint8_t data;
+
 	/* Wait for data to be received */
-	while ( !(UCSRA & (1<<RXC)))
+	while ( !uart_rx_read(&data) )
 	;
-	/* Get and return received data from buffer */
-	return UDR;
+	return data;
 }
 
-/* @brief method for sending data Buffering up data in the UDR, and transmit it using polling 
+/**
+ * @brief Number of bytes that can still be put into the transmit buffer.
+ *
+ * One slot is always kept free to tell a full buffer from an empty one, so an
+ * empty buffer reports UART_TX_BUFFER_SIZE - 1.
+ *
+ * @see uart_tx_write
+ */
+uint8_t uart_tx_free(void)
+{
+	return ( uart_tx_tail - uart_tx_head - 1 ) & UART_TX_BUFFER_MASK;
+}
+
+/**
+ * @brief Puts a block of bytes into the transmit buffer without waiting.
+ *
+ * The block is either queued completely or not at all, so a frame is never
+ * cut in half on the line. If there is not enough room, nothing is queued,
+ * ::uart_tx_dropped is increased by \b length and 0 is returned. The caller
+ * may retry later or use uart_tx_flush() to make room.
+ *
+ * The bytes are sent in the background by ISR(USART_UDRE_vect); the function
+ * returns as soon as they are copied.
+ *
+ * @param data pointer to the bytes to send.
+ * @param length number of bytes to send.
+ *
+ * @return \b length if the block was queued, 0 otherwise.
+ *
+ * @see uart_tx_free
+ * @see uart_tx_flush
+ */
+uint8_t uart_tx_write(const uint8_t *data, uint8_t length)
+{
+	uint8_t head = uart_tx_head;
+	uint8_t i;
+
+	if ( length > uart_tx_free() )
+	{
+		uart_tx_dropped += length;
+		return 0;
+	}
+
+	for ( i = 0; i < length; i++ )
+	{
+		uart_tx_buffer[ head ] = data[ i ];
+		head = ( head + 1 ) & UART_TX_BUFFER_MASK;
+	}
+	/* Publish the bytes to the ISR in one single byte write. */
+	uart_tx_head = head;
+	/* (Re)start draining the buffer. */
+	UCSRB |= (1<<UDRIE);
+
+	return length;
+}
+
+/**
+ * @brief Waits until every queued byte has left the transmitter.
+ *
+ * Returns when the transmit buffer is empty and the last stop bit has been
+ * shifted out (TXC), e.g. before going to sleep or changing the baud rate.
+ * Returns at once if nothing was sent since the last flush.
+ *
+ * @see uart_tx_write
+ */
+void uart_tx_flush(void)
+{
+	/* Wait for the ISR to empty the buffer, it disables itself then. */
+	while ( UCSRB & (1<<UDRIE) )
+	;
+	/* Wait for the shift register to run empty. */
+	if ( uart_tx_sent )
+	{
+		while ( !(UCSRA & (1<<TXC)) )
+		;
+		uart_tx_sent = 0;
+	}
+}
+
+/* @brief method for sending one byte through the transmit buffer
+ *
+ * Waits only while the transmit buffer is full, otherwise the byte is queued
+ * and the method returns at once. Waiting does not count as a drop in
+ * ::uart_tx_dropped, the byte is never lost.
  *
  * @param data to be sent
 
 */
 void usart_transmit( char data)
 {
-	/* Wait for data to be transmitted */
-	while ( !(UCSRA & (1<<UDRE)));
-
-	UDR=data;
+	uint8_t byte = data;
 
+	/* Wait for a free slot in the transmit buffer */
+	while ( !uart_tx_free() )
+	;
+	uart_tx_write(&byte, 1);
 }
 
-/* @brief Sends a string through the UART using the usart_transmit() method. 
+/* @brief Sends a string through the UART using the transmit buffer.
  *
  * @brief Array pointer is used for the data
+ *
+ * The string is queued as one block if it fits into the free part of the
+ * buffer, otherwise it is queued byte by byte, waiting only for free slots.
  * 
+ * @see uart_tx_write
  * @see usart_transmit
 
- method used for transmitting a string polling based*/
+ method used for transmitting a string interrupt based*/
 void SendString (char *s)
 {
-  char c=0;
-	
+	size_t length = strlen(s);
+
 	//usart_transmit(0x0d);           //line shift
 	//usart_transmit(0x0a);			//new line
+	if ( length <= uart_tx_free() )
+	{
+		uart_tx_write((const uint8_t *)s, length);
+		return;
+	}
 	//  loop until *s != NULL
-	for (;(( c=*s)!=0);s++){
-	usart_transmit(*s);   //start the process of transmit interrupts
+	for (; *s != 0; s++){
+	usart_transmit(*s);   //blocks only while the buffer is full
 }
 }
 
@@ -75,15 +321,22 @@ void SendString (char *s)
  *
  * Selects the number of stop bits to be inserted by the transmitter (setting 0 means 1 stop bit is used)
  * Sets the number of data bit s (8 bits)
- * Enables full duplex, double transmission speed
+ * Enables full duplex, double transmission speed if requested
  * Configures baud rate
- * Enables global interrupts
  *
- * @param baud for seting baud rate(bits per second)
+ * Use the values calculated in baud.h instead of magic numbers:
+ * \code
+ * USART_Init( UART_UBRR , UART_USE_2X );
+ * \endcode
+ *
+ * @param baud UBRR value for seting baud rate(bits per second)
+ * @param double_speed non 0 to set U2X, must match the UBRR value
  *
  * @see usart_transmit
+ * @see UART_UBRR
+ * @see UART_USE_2X
  */
-void USART_Init( unsigned int baud )
+void USART_Init( unsigned int baud , uint8_t double_speed )
 {
 
 
@@ -91,7 +344,14 @@ void USART_Init( unsigned int baud )
 	/* Set frame format:enable the UCSRC for writing
 						  1 stop bit, 8 data bit */
 	UCSRC|= (1<<URSEL)|(0<<USBS)|(3<<UCSZ0);     
-	UCSRA =(1<<U2X);        //double speed full duplex
+	if ( double_speed )
+	{
+		UCSRA =(1<<U2X);        //double speed full duplex
+	}
+	else
+	{
+		UCSRA = 0;
+	}
 
 	/* Set baud rate */
 					
@@ -100,13 +360,64 @@ void USART_Init( unsigned int baud )
 	/* Enable receiver and transmitter */
 
 }
-/* interrupt service routine for receive complete - c-cmpiler manual p.133*/
+/**
+ * @brief interrupt service routine for data register empty
+ *
+ * Moves the next byte from the transmit buffer into UDR. When the buffer is
+ * empty the interrupt disables itself; uart_tx_write() enables it again.
+ */
+ISR(USART_UDRE_vect)
+{
+	uint8_t tail = uart_tx_tail;
+
+	if ( tail == uart_tx_head )
+	{
+		UCSRB &= ~(1<<UDRIE);
+		return;
+	}
+	/* Clearing TXC so uart_tx_flush() waits for this byte. */
+	UCSRA = (UCSRA & ((1<<U2X)|(1<<MPCM))) | (1<<TXC);
+	UDR = uart_tx_buffer[ tail ];
+	uart_tx_sent = 1;
+	uart_tx_tail = ( tail + 1 ) & UART_TX_BUFFER_MASK;
+}
+
+/**
+ * @brief interrupt service routine for receive complete - c-cmpiler manual p.133
+ *
+ * Moves the received byte into the receive buffer. The status flags must be
+ * read before UDR, they belong to the byte at the top of the hardware FIFO.
+ * A byte with a framing error is counted and dropped. A data overrun means a
+ * byte was lost in hardware before this one, this byte itself is still
+ * valid. If the receive buffer is full, the new byte is dropped and counted.
+ */
 ISR(USART_RXC_vect) 
 {
-	ch = UDR;
+	uint8_t status = UCSRA;
+	uint8_t data = UDR;
+	uint8_t head = uart_rx_head;
+	uint8_t next = ( head + 1 ) & UART_RX_BUFFER_MASK;
 
-	/*SPI_MasterTransmit(ch);*/
-	flag_u=1;
+	if ( status & (1<<DOR) )
+	{
+		uart_rx_counters.data_overruns++;
+	}
+	if ( status & (1<<FE) )
+	{
+		uart_rx_counters.frame_errors++;
+		return;
+	}
+	if ( next == uart_rx_tail )
+	{
+		uart_rx_counters.buffer_overflows++;
+		return;
+	}
+	uart_rx_buffer[ head ] = data;
+	uart_rx_head = next;
+	if ( uart_rx_event )
+	{
+		uart_rx_event();
+	}
 }
 #endif /* uart_driver_H_INCLUDED */
 
@@ -1,5 +1,6 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <stdint.h>
 
 /**
  * @file
@@ -7,9 +8,34 @@
  * 
  * @author Gunnar
  */
-extern void USART_Init( unsigned int baud );
-extern void SendString (char *s);  //used when polling transmit
-extern void usart_transmit(unsigned char data); //Polling transmit one char/byte
+#ifndef UART_DRIVER_H_INCLUDED
+#define UART_DRIVER_H_INCLUDED
 
-extern unsigned char ch;
-extern char flag_u;
+/**
+ * @brief Receive error counters of the USART.
+ *
+ * @see uart_rx_get_stats
+ */
+struct uart_rx_stats
+{
+	uint16_t frame_errors;     /**< bytes dropped because of a framing error (FE) */
+	uint16_t data_overruns;    /**< hardware overruns (DOR), bytes lost before the ISR ran */
+	uint16_t buffer_overflows; /**< bytes dropped because the receive buffer was full */
+};
+
+extern void USART_Init( unsigned int baud , uint8_t double_speed ); //use UART_UBRR and UART_USE_2X from baud.h
+extern void SendString (char *s);  //queues a string, waits only if the buffer is full
+extern void usart_transmit(char data); //queues one char/byte, waits only if the buffer is full
+extern uint8_t uart_tx_write(const uint8_t *data, uint8_t length); //non blocking, all or nothing
+extern uint8_t uart_tx_free(void); //free bytes in the transmit buffer
+extern void uart_tx_flush(void); //waits until everything is sent
+
+extern volatile uint16_t uart_tx_dropped;
+
+extern char usart_receive(void); //waits for one received byte
+extern uint8_t uart_rx_read(uint8_t *data); //non blocking, 1 if a byte was read
+extern uint8_t uart_rx_available(void); //bytes waiting in the receive buffer
+extern void uart_rx_get_stats(struct uart_rx_stats *stats);
+extern void (*uart_rx_event)(void); //called from the receive interrupt, may be 0
+
+#endif /* UART_DRIVER_H_INCLUDED */